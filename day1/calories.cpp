@@ -1,51 +1,243 @@
 #include <algorithm>
+#include <cassert>
+#include <charconv>
 #include <cstdint>
+#include <cstring>
 #include <format>
 #include <fstream>
 #include <iostream>
-#include <numeric>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
-struct Elf {
-    std::vector<uint64_t> foods;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-    Elf() noexcept { foods.reserve(8); }
-    [[nodiscard]] uint64_t calories() const noexcept { return std::accumulate(foods.begin(), foods.end(), 0ULL); }
+struct ElfTotal {
+    uint64_t calories = 0;
+    size_t index = 0;
+    size_t foodCount = 0;
 };
 
-int main()
+// more calories wins, on equal calories the elf that came first wins
+[[nodiscard]] bool carriesMore(const ElfTotal& lhs, const ElfTotal& rhs) noexcept
+{
+    return lhs.calories > rhs.calories | (lhs.calories == rhs.calories & lhs.index < rhs.index);
+}
+
+struct TopElfs {
+    size_t k;
+    // min-heap on carriesMore, the front is the weakest of the kept elfs
+    std::vector<ElfTotal> heap;
+
+    explicit TopElfs(size_t count) noexcept : k(count) { heap.reserve(k); }
+
+    void offer(const ElfTotal& elf) noexcept;
+    [[nodiscard]] std::vector<ElfTotal> sorted() const noexcept;
+};
+
+void TopElfs::offer(const ElfTotal& elf) noexcept
+{
+    if(heap.size() < k) {
+        heap.emplace_back(elf);
+        std::ranges::push_heap(heap, &carriesMore);
+    }
+    else if(k > 0 && carriesMore(elf, heap.front())) {
+        std::ranges::pop_heap(heap, &carriesMore);
+        heap.back() = elf;
+        std::ranges::push_heap(heap, &carriesMore);
+    }
+}
+
+std::vector<ElfTotal> TopElfs::sorted() const noexcept
 {
-    std::vector<Elf> elfs;
-    elfs.reserve(1024);
-    elfs.emplace_back();
+    auto result = heap;
+    std::ranges::sort(result, &carriesMore);
+    return result;
+}
 
-    std::ifstream file("calories_input.txt");
+// Folds every elf into a running sum while reading, only the best k elfs are kept.
+TopElfs parseTopElfs(std::string_view filepath, size_t k) noexcept
+{
+    TopElfs topElfs(k);
+    ElfTotal current;
+
+    std::ifstream file(filepath.data());
     std::string line;
     while(std::getline(file, line)) {
         if (line.empty()) {
-            elfs.emplace_back();
+            topElfs.offer(current);
+            current = ElfTotal{ .index = current.index + 1 };
         }
         else {
-            elfs.back().foods.emplace_back(std::stoi(line));
+            current.calories += std::stoull(line);
+            ++current.foodCount;
         }
     }
+    topElfs.offer(current);
 
-    auto it = std::ranges::max_element(elfs, {}, &Elf::calories);
-    auto index = std::distance(elfs.begin(), it);
+    return topElfs;
+}
 
-    std::cout << std::format("Elf #{} is carrying {} food items with a total of {} calories.\n", index, elfs[index].foods.size(), elfs[index].calories());
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    bool valid = false;
 
-    std::cout << "\nPart 2:\n";
+    explicit MappedFile(std::string_view filepath) noexcept;
+    ~MappedFile() noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::string_view view() const noexcept { return { data, size }; }
+};
+
+MappedFile::MappedFile(std::string_view filepath) noexcept
+{
+    const int fd = open(filepath.data(), O_RDONLY);
+    if(fd < 0) {
+        return;
+    }
+
+    struct stat fileStat{};
+    if(fstat(fd, &fileStat) == 0) {
+        size = static_cast<size_t>(fileStat.st_size);
+        if(size == 0) {
+            valid = true;
+        }
+        else if(void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0); mapped != MAP_FAILED) {
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapped);
+            valid = true;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() noexcept
+{
+    if(data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+struct ShardResult {
+    TopElfs topElfs;
+    // number of elfs that were finished inside the shard
+    size_t elfCount = 0;
+};
+
+// Scans one shard of the calorie list. The elf that is still open at the end of the
+// shard continues in the next shard, so it is only finished for the last shard.
+ShardResult scanShard(std::string_view shard, size_t k, bool finishLastElf) noexcept
+{
+    ShardResult result{ TopElfs(k) };
+    ElfTotal current;
 
-    std::ranges::partial_sort(elfs, elfs.begin() + 3, std::greater{}, &Elf::calories);
+    const char* it = shard.data();
+    const char* end = it + shard.size();
+    while(it != end) {
+        // memchr is the vectorised newline search of the c library
+        const char* lineEnd = static_cast<const char*>(std::memchr(it, '\n', static_cast<size_t>(end - it)));
+        if(lineEnd == nullptr) {
+            lineEnd = end;
+        }
+
+        if(it == lineEnd) {
+            result.topElfs.offer(current);
+            current = ElfTotal{ .index = current.index + 1 };
+        }
+        else {
+            uint64_t value = 0;
+            [[maybe_unused]] const auto [ptr, ec] = std::from_chars(it, lineEnd, value);
+            assert(ec == std::errc{} && "Unexpected input format.");
+            current.calories += value;
+            ++current.foodCount;
+        }
+
+        it = lineEnd == end ? end : lineEnd + 1;
+    }
+
+    if(finishLastElf) {
+        result.topElfs.offer(current);
+    }
+    result.elfCount = current.index;
+
+    return result;
+}
+
+// Splits the input into shards that each begin right after a blank line.
+std::vector<std::string_view> splitIntoShards(std::string_view data, size_t shardCount) noexcept
+{
+    std::vector<std::string_view> shards;
+    shards.reserve(shardCount);
+
+    size_t begin = 0;
+    for(size_t i = 1; i < shardCount & begin < data.size(); ++i) {
+        const size_t target = std::max(begin, data.size() / shardCount * i);
+        const size_t blankLine = data.find("\n\n", target);
+        if(blankLine == std::string_view::npos) {
+            break;
+        }
+        shards.emplace_back(data.substr(begin, blankLine + 2 - begin));
+        begin = blankLine + 2;
+    }
+    shards.emplace_back(data.substr(begin));
+
+    return shards;
+}
+
+// Same result as parseTopElfs, but the mapped file is scanned by one thread per shard.
+TopElfs parseTopElfsParallel(std::string_view data, size_t k, size_t threadCount) noexcept
+{
+    const auto shards = splitIntoShards(data, std::max<size_t>(threadCount, 1));
+
+    std::vector<ShardResult> results(shards.size(), ShardResult{ TopElfs(k) });
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(shards.size());
+        for(size_t i = 0; i < shards.size(); ++i) {
+            threads.emplace_back([&, i]() { results[i] = scanShard(shards[i], k, i + 1 == shards.size()); });
+        }
+    }
+
+    TopElfs merged(k);
+    size_t indexOffset = 0;
+    for(const auto& result : results) {
+        for(auto elf : result.topElfs.heap) {
+            elf.index += indexOffset;
+            merged.offer(elf);
+        }
+        indexOffset += result.elfCount;
+    }
+
+    return merged;
+}
+
+int main()
+{
+    constexpr std::string_view inputPath = "calories_input.txt";
+
+    const MappedFile mappedFile(inputPath);
+    const auto topElfs = mappedFile.valid
+        ? parseTopElfsParallel(mappedFile.view(), 3, std::thread::hardware_concurrency()).sorted()
+        : parseTopElfs(inputPath, 3).sorted();
+    assert(topElfs.size() == 3);
+
+    const auto& best = topElfs.front();
+    std::cout << std::format("Elf #{} is carrying {} food items with a total of {} calories.\n", best.index, best.foodCount, best.calories);
+
+    std::cout << "\nPart 2:\n";
 
     uint64_t sum = 0;
-    for(int i = 0; i < 3; ++i) {
-        sum += elfs[i].calories();
+    for(const auto& elf : topElfs) {
+        sum += elf.calories;
     }
     std::cout << std::format("The three elfs with the most calories are carrying {}, {} and {} calories. That are in total {} calories.\n",
-                             elfs[0].calories(), elfs[1].calories(), elfs[2].calories(), sum);
+                             topElfs[0].calories, topElfs[1].calories, topElfs[2].calories, sum);
 
     return 0;
 }
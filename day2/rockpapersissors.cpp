@@ -1,225 +1,293 @@
+#include <array>
 #include <cassert>
 #include <cstdint>
 #include <format>
 #include <fstream>
 #include <iostream>
 #include <numeric>
-#include <regex>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
-enum class Play : int8_t {
-    Rock = 0,
-    Paper = 1,
-    Sissors = 2
+using Move = uint8_t;
+
+enum class RoundOutcome : uint8_t {
+    Loss = 0,
+    Draw = 1,
+    Win = 2
 };
 
-uint64_t playToScore(Play play) noexcept;
+constexpr size_t OutcomeCount = 3;
 
-enum class RoundOutcome {
-    Win,
-    Loss,
-    Draw
+struct ScoreWeights {
+    uint8_t loss = 0;
+    uint8_t draw = 3;
+    uint8_t win = 6;
+    // the score of move i is firstMove + i
+    uint8_t firstMove = 1;
 };
 
-RoundOutcome lhsOutcome(Play lhsPlay, Play rhsPlay) noexcept;
-uint64_t roundOutcomeToScore(RoundOutcome outcome) noexcept;
+// every move beats the moves an odd number of steps below it in the cycle,
+// for 3 moves that is rock paper scissors, for 5 moves rock paper scissors lizard spock
+struct OddDistanceDominance {
+    constexpr bool operator()(size_t moveCount, Move lhs, Move rhs) const noexcept
+    {
+        return (lhs + moveCount - rhs) % moveCount % 2 == 1;
+    }
+};
 
-struct Round {
-    Play opponentPlay;
-    Play myPlay;
+// A cyclic dominance game. All outcome and strategy tables are generated at compile time,
+// so scoring a round at runtime is a single table load.
+template <size_t MoveCount, ScoreWeights Weights = ScoreWeights{}, typename Dominance = OddDistanceDominance>
+struct CyclicGame {
+    static constexpr size_t Moves = MoveCount;
 
-    [[nodiscard]] uint64_t score() const noexcept
+    static constexpr RoundOutcome outcome(Move mine, Move opponent) noexcept
     {
-        const auto playScore = playToScore(myPlay);
-        const auto outcomeScore = roundOutcomeToScore(lhsOutcome(myPlay, opponentPlay));
-        return playScore + outcomeScore;
+        if(mine == opponent) {
+            return RoundOutcome::Draw;
+        }
+        return Dominance{}(MoveCount, mine, opponent) ? RoundOutcome::Win : RoundOutcome::Loss;
     }
-};
 
-uint64_t playToScore(Play play) noexcept
-{
-    switch (play) {
-        case Play::Rock:
-            return 1;
-        case Play::Paper:
-            return 2;
-        case Play::Sissors:
-            return 3;
+    static constexpr uint8_t outcomeScore(RoundOutcome result) noexcept
+    {
+        constexpr std::array<uint8_t, OutcomeCount> scores{ Weights.loss, Weights.draw, Weights.win };
+        return scores[static_cast<size_t>(result)];
     }
 
-    assert(false && "Invalid play input.");
-    return 0;
-}
+    static constexpr uint8_t moveScore(Move mine) noexcept { return static_cast<uint8_t>(Weights.firstMove + mine); }
 
-RoundOutcome lhsOutcome(Play lhsPlay, Play rhsPlay) noexcept
-{
-    if(lhsPlay == rhsPlay) {
-        return RoundOutcome::Draw;
+    // [opponent][mine] -> my score of the round
+    static constexpr auto ScoreTable = []() {
+        std::array<std::array<uint8_t, MoveCount>, MoveCount> table{};
+        for(Move opponent = 0; opponent < MoveCount; ++opponent) {
+            for(Move mine = 0; mine < MoveCount; ++mine) {
+                table[opponent][mine] = static_cast<uint8_t>(moveScore(mine) + outcomeScore(outcome(mine, opponent)));
+            }
+        }
+        return table;
+    }();
+
+    // [opponent][desired outcome] -> the first move that achieves the outcome
+    static constexpr auto StrategyTable = []() {
+        std::array<std::array<Move, OutcomeCount>, MoveCount> table{};
+        for(Move opponent = 0; opponent < MoveCount; ++opponent) {
+            for(size_t result = 0; result < OutcomeCount; ++result) {
+                Move mine = 0;
+                while(mine < MoveCount && outcome(mine, opponent) != static_cast<RoundOutcome>(result)) {
+                    ++mine;
+                }
+                table[opponent][result] = mine;
+            }
+        }
+        return table;
+    }();
+
+    static constexpr bool validRules() noexcept
+    {
+        for(Move lhs = 0; lhs < MoveCount; ++lhs) {
+            for(Move rhs = 0; rhs < MoveCount; ++rhs) {
+                const bool lhsBeatsRhs = lhs != rhs && Dominance{}(MoveCount, lhs, rhs);
+                const bool rhsBeatsLhs = lhs != rhs && Dominance{}(MoveCount, rhs, lhs);
+                if(lhs != rhs && lhsBeatsRhs == rhsBeatsLhs) {
+                    return false;
+                }
+            }
+            for(size_t result = 0; result < OutcomeCount; ++result) {
+                if(StrategyTable[lhs][result] == MoveCount) {
+                    return false;
+                }
+            }
+        }
+        return true;
     }
 
-    const auto lhsInt = static_cast<int8_t>(lhsPlay);
-    const auto rhsInt = static_cast<int8_t>(rhsPlay);
+    static_assert(validRules(), "Every pair of moves needs exactly one winner and every outcome has to be reachable.");
+};
 
-    if(lhsInt < rhsInt) {
-        const auto difference = rhsInt - lhsInt;
-        return difference == 1 ? RoundOutcome::Loss : RoundOutcome::Win;
-    }
-    else {
-        assert(lhsInt > rhsInt);
-        const auto difference = lhsInt - rhsInt;
-        return difference == 2 ? RoundOutcome::Loss : RoundOutcome::Win;
-    }
+using RockPaperSissors = CyclicGame<3>;
+using RockPaperSissorsLizardSpock = CyclicGame<5>;
 
-    assert(false && "Invalid play input.");
-    return {};
-}
+static_assert(RockPaperSissors::ScoreTable[0][1] == 8, "Paper beats rock.");
+static_assert(RockPaperSissors::ScoreTable[1][0] == 1, "Rock loses against paper.");
+static_assert(RockPaperSissors::StrategyTable[2][static_cast<size_t>(RoundOutcome::Win)] == 0, "Rock beats sissors.");
+static_assert(RockPaperSissorsLizardSpock::ScoreTable[0][3] == 10, "Every move beats two others.");
 
-uint64_t roundOutcomeToScore(RoundOutcome outcome) noexcept
+// A round is stored in 4 bits: the opponent move in the upper two bits and the
+// strategy guide column (X = 0, Y = 1, Z = 2) in the lower two bits.
+using RoundCode = uint8_t;
+using RoundTable = std::array<uint8_t, 16>;
+// the scores of both rounds packed into a byte
+using ByteTable = std::array<uint16_t, 256>;
+
+constexpr RoundCode toRoundCode(Move opponent, uint8_t column) noexcept
 {
-    switch (outcome) {
-        case RoundOutcome::Win:
-            return 6;
-        case RoundOutcome::Loss:
-            return 0;
-        case RoundOutcome::Draw:
-            return 3;
+    return static_cast<RoundCode>(opponent << 2 | column);
+}
+
+// two rounds per byte, an odd round count is padded with the unused code 0xF which scores 0
+struct PackedRounds {
+    constexpr static RoundCode PaddingCode = 0xF;
+
+    std::vector<uint8_t> bytes;
+    size_t count = 0;
+
+    void push(RoundCode code) noexcept
+    {
+        if(count % 2 == 0) {
+            bytes.emplace_back(static_cast<uint8_t>(PaddingCode << 4 | code));
+        }
+        else {
+            bytes.back() = static_cast<uint8_t>((bytes.back() & 0x0F) | code << 4);
+        }
+        ++count;
     }
+};
 
-    assert(false && "Invalid round outcome input.");
-    return -1;
+// the unused codes, including the padding code, score 0
+template <typename Game>
+    requires (Game::Moves <= 3)
+constexpr RoundTable makeRoundTable(auto columnToMove) noexcept
+{
+    RoundTable table{};
+    for(Move opponent = 0; opponent < Game::Moves; ++opponent) {
+        for(uint8_t column = 0; column < 3; ++column) {
+            table[toRoundCode(opponent, column)] = Game::ScoreTable[opponent][columnToMove(opponent, column)];
+        }
+    }
+    return table;
 }
 
-Play opponentStrToPlay(const std::string& opponentStr) noexcept
+// part 1: the column is my move
+template <typename Game>
+constexpr RoundTable makePlayTable() noexcept
 {
-    assert(opponentStr.size() == 1);
-    switch (opponentStr[0]) {
-        case 'A':
-            return Play::Rock;
-        case 'B':
-            return Play::Paper;
-        case 'C':
-            return Play::Sissors;
-        default:
-            abort();
-    }
+    return makeRoundTable<Game>([](Move, uint8_t column) { return column; });
 }
 
-Play myStrToPlay(const std::string& myStr) noexcept
+// part 2: the column is the desired outcome
+template <typename Game>
+constexpr RoundTable makeOutcomeTable() noexcept
 {
-    assert(myStr.size() == 1);
-    switch (myStr[0]) {
-        case 'X':
-            return Play::Rock;
-        case 'Y':
-            return Play::Paper;
-        case 'Z':
-            return Play::Sissors;
-        default:
-            abort();
-    }
+    return makeRoundTable<Game>([](Move opponent, uint8_t column) { return Game::StrategyTable[opponent][column]; });
 }
 
-RoundOutcome outcomeStrToOutcome(const std::string& outcomeStr) noexcept
+constexpr ByteTable widenRoundTable(const RoundTable& table) noexcept
 {
-    assert(outcomeStr.size() == 1);
-    switch (outcomeStr[0]) {
-        case 'X':
-            return RoundOutcome::Loss;
-        case 'Y':
-            return RoundOutcome::Draw;
-        case 'Z':
-            return RoundOutcome::Win;
-        default:
-            abort();
+    ByteTable byteTable{};
+    for(size_t byte = 0; byte < byteTable.size(); ++byte) {
+        byteTable[byte] = table[byte & 0x0F] + table[byte >> 4];
     }
+    return byteTable;
 }
 
-Play opponentPlayAndOutcomeToPlay(Play opponentPlay, RoundOutcome outcome) noexcept
+// Scores two rounds per table load with the widened table, the sum is split into independent
+// lanes so the additions can be pipelined.
+uint64_t scorePackedRounds(const PackedRounds& rounds, const ByteTable& byteTable) noexcept
 {
-    const auto opponentPlayInt = static_cast<int8_t>(opponentPlay);
-    
-    switch (outcome) {
-        case RoundOutcome::Draw:
-            return opponentPlay;
-        case RoundOutcome::Loss: {
-            const auto minusOne = opponentPlayInt - 1;
-            return minusOne >= 0 ? static_cast<Play>(minusOne) : Play::Sissors;
-        }
-        case RoundOutcome::Win: {
-            const auto plusOne = opponentPlayInt + 1;
-            return plusOne <= 2 ? static_cast<Play>(plusOne) : Play::Rock;
+    constexpr size_t Lanes = 8;
+    std::array<uint64_t, Lanes> sums{};
+
+    const auto& bytes = rounds.bytes;
+    const size_t blockEnd = bytes.size() - bytes.size() % Lanes;
+    for(size_t i = 0; i < blockEnd; i += Lanes) {
+        for(size_t lane = 0; lane < Lanes; ++lane) {
+            sums[lane] += byteTable[bytes[i + lane]];
         }
     }
+    for(size_t i = blockEnd; i < bytes.size(); ++i) {
+        sums[0] += byteTable[bytes[i]];
+    }
 
-    assert(false && "Invalid outcome input.");
-    return {};
+    return std::accumulate(sums.begin(), sums.end(), 0ULL);
 }
 
-std::vector<Round> parseRounds(std::string_view filepath) noexcept
+std::optional<RoundCode> parseRoundCode(std::string_view line) noexcept
 {
-    const std::regex roundRegex("([A-C]) ([X-Z])");
-    std::smatch playMatch;
+    const bool valid = line.size() == 3 && line[0] >= 'A' && line[0] <= 'C' && line[1] == ' ' && line[2] >= 'X' && line[2] <= 'Z';
+    if(not valid) [[unlikely]] {
+        return std::nullopt;
+    }
+    return toRoundCode(static_cast<Move>(line[0] - 'A'), static_cast<uint8_t>(line[2] - 'X'));
+}
 
-    std::vector<Round> rounds;
-    rounds.reserve(1024);
+struct Strategy {
+    // widened once when the strategy is added, not for every block
+    ByteTable byteTable;
+};
 
-    std::fstream file(filepath.data());
-    std::string line;
-    while(std::getline(file, line)) {
-        if(std::regex_match(line, playMatch, roundRegex)) [[likely]] {
-            assert(playMatch.size() == 3);
-            rounds.emplace_back(opponentStrToPlay(playMatch[1].str()), myStrToPlay(playMatch[2].str()));
-        }
-        else {
-            assert(false && "Didn't expect no match.");
-        }
-    }
+struct StrategyResults {
+    size_t roundCount = 0;
+    // one total per registered strategy, in registration order
+    std::vector<uint64_t> totals;
+};
 
-    return rounds;
-}
+// Reads the strategy guide once and scores it under every registered column interpretation.
+// Rounds are packed into a fixed size block that is scored and reused, so memory does not grow with the input.
+struct StrategyEvaluator {
+    constexpr static size_t BlockSize = 4096;
 
-std::vector<Round> parseRoundsPart2(std::string_view filepath) noexcept
+    std::vector<Strategy> strategies;
+
+    void add(const RoundTable& table) noexcept { strategies.push_back(Strategy{ widenRoundTable(table) }); }
+    [[nodiscard]] StrategyResults evaluate(std::string_view filepath) const noexcept;
+};
+
+StrategyResults StrategyEvaluator::evaluate(std::string_view filepath) const noexcept
 {
-    const std::regex roundRegex("([A-C]) ([X-Z])");
-    std::smatch playMatch;
+    StrategyResults results;
+    results.totals.resize(strategies.size(), 0);
+
+    PackedRounds block;
+    block.bytes.reserve(BlockSize / 2);
 
-    std::vector<Round> rounds;
-    rounds.reserve(1024);
+    const auto scoreBlock = [&]() {
+        for(size_t i = 0; i < strategies.size(); ++i) {
+            results.totals[i] += scorePackedRounds(block, strategies[i].byteTable);
+        }
+        results.roundCount += block.count;
+        block.bytes.clear();
+        block.count = 0;
+    };
 
     std::fstream file(filepath.data());
     std::string line;
     while(std::getline(file, line)) {
-        if(std::regex_match(line, playMatch, roundRegex)) {
-            assert(playMatch.size() == 3);
-            const auto opponentPlay = opponentStrToPlay(playMatch[1].str());
-            const auto desiredOutcome = outcomeStrToOutcome(playMatch[2].str());
-            rounds.emplace_back(opponentPlay, opponentPlayAndOutcomeToPlay(opponentPlay, desiredOutcome));
+        const auto code = parseRoundCode(line);
+        assert(code.has_value() && "Didn't expect no match.");
+        if(not code.has_value()) {
+            continue;
         }
-        else {
-            assert(false && "Didn't expect no match.");
+
+        block.push(*code);
+        if(block.count == BlockSize) {
+            scoreBlock();
         }
     }
+    scoreBlock();
 
-    return rounds;
+    return results;
 }
 
 int main()
 {
-    const auto rounds = parseRounds("rockpapersissors_input.txt");
-    const auto myScore = std::accumulate(rounds.begin(), rounds.end(), 0ULL, [](uint64_t v, const Round& r) { return v + r.score(); });
+    StrategyEvaluator evaluator;
+    // part 1 the column is my move, part 2 it is the desired outcome
+    evaluator.add(makePlayTable<RockPaperSissors>());
+    evaluator.add(makeOutcomeTable<RockPaperSissors>());
 
-    std::cout << std::format("My score after playing {} rounds following the strategy guide: {}\n", rounds.size(), myScore);
+    const auto results = evaluator.evaluate("rockpapersissors_input.txt");
 
+    std::cout << std::format("My score after playing {} rounds following the strategy guide: {}\n", results.roundCount, results.totals[0]);
 
 
-    std::cout << "Part2:\n";
 
-    const auto rounds2 = parseRoundsPart2("rockpapersissors_input.txt");
-    const auto myScore2 = std::accumulate(rounds2.begin(), rounds2.end(), 0ULL, [](uint64_t v, const Round& r) { return v + r.score(); });
+    std::cout << "Part2:\n";
 
-    std::cout << std::format("My score after playing {} rounds following the strategy guide: {}\n", rounds2.size(), myScore2);
+    std::cout << std::format("My score after playing {} rounds following the strategy guide: {}\n", results.roundCount, results.totals[1]);
 
 
     return 0;
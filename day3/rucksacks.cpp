@@ -1,15 +1,14 @@
-#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
 #include <cstdint>
 #include <format>
 #include <fstream>
 #include <iostream>
-#include <numeric>
 #include <string>
 #include <string_view>
-#include <vector>
 
-uint64_t itemPriority(char item) noexcept
+constexpr uint64_t itemPriority(char item) noexcept
 {
     if(item >= 'a' & item <= 'z') {
         return item - 'a' + 1;
@@ -20,81 +19,102 @@ uint64_t itemPriority(char item) noexcept
     return 0;
 }
 
-struct Rucksack {
-    std::string _contents;
-    std::string _duplicates;
-
-    void findDuplicates() noexcept
-    {
-        assert(_contents.size() % 2 == 0);
-        auto middle = _contents.begin() + std::ssize(_contents) / 2;
-        for(auto it = _contents.begin(); it != middle; ++it) {
-            for(auto jt = middle; jt != _contents.end(); ++jt) {
-                if(*it == *jt) {
-                    _duplicates.push_back(*it);
-                    break;
-                }
-            }
-        }
-        auto removeRange = std::ranges::unique(_duplicates);
-        _duplicates.erase(removeRange.begin(), removeRange.end());
-    }
+// bit i is set when the item with priority i is present, bit 0 stays unused
+using ItemMask = uint64_t;
 
-    [[nodiscard]] uint64_t duplicatePrioritiesSum() const noexcept
-    {
-        return std::accumulate(_duplicates.begin(), _duplicates.end(), 0ULL, [](uint64_t v, char c){ return v + itemPriority(c); });
+// byte classification table, bytes that are no item map to an empty mask
+constexpr auto ItemBits = []() {
+    std::array<ItemMask, 256> bits{};
+    for(size_t byte = 0; byte < bits.size(); ++byte) {
+        const auto priority = itemPriority(static_cast<char>(byte));
+        bits[byte] = priority == 0 ? 0 : ItemMask{ 1 } << priority;
     }
-};
+    return bits;
+}();
 
-char findGroupItem(const Rucksack& first, const Rucksack& second, const Rucksack& third) noexcept
+ItemMask itemMask(std::string_view items) noexcept
 {
-    for(auto it = first._contents.begin(); it != first._contents.end(); ++it) {
-        const bool secondHasIt = std::ranges::find(second._contents, *it) != second._contents.end();
-        const bool thirdHasIt = std::ranges::find(third._contents, *it) != third._contents.end();
-        if(secondHasIt & thirdHasIt) {
-            return *it;
+    // independent accumulators so the table loads are not serialized on a single or chain
+    std::array<ItemMask, 4> masks{};
+    const size_t blockEnd = items.size() - items.size() % masks.size();
+    for(size_t i = 0; i < blockEnd; i += masks.size()) {
+        for(size_t lane = 0; lane < masks.size(); ++lane) {
+            masks[lane] |= ItemBits[static_cast<uint8_t>(items[i + lane])];
         }
     }
-    return '\0';
+    for(size_t i = blockEnd; i < items.size(); ++i) {
+        masks[0] |= ItemBits[static_cast<uint8_t>(items[i])];
+    }
+    return masks[0] | masks[1] | masks[2] | masks[3];
 }
 
-std::vector<Rucksack> parseRucksacks(std::string_view filepath) noexcept
+uint64_t maskPrioritiesSum(ItemMask mask) noexcept
 {
-    std::vector<Rucksack> rucksacks;
-    rucksacks.reserve(4096);
+    uint64_t sum = 0;
+    for(; mask != 0; mask &= mask - 1) {
+        sum += std::countr_zero(mask);
+    }
+    return sum;
+}
 
-    std::ifstream file(filepath.data());
-    rucksacks.emplace_back();
+struct RucksackReport {
+    uint64_t duplicatePrioritiesSum = 0;
+    uint64_t groupItemPrioritySum = 0;
+    size_t rucksackCount = 0;
+    size_t groupCount = 0;
+    // rucksacks at the end of the input that do not fill a whole group
+    size_t ungroupedRucksacks = 0;
+};
 
-    while(std::getline(file, rucksacks.back()._contents)) {
-        rucksacks.emplace_back();
+// Streams the rucksack list once, only the item masks of the current group are kept.
+RucksackReport evaluateRucksacks(std::string_view filepath, size_t groupSize) noexcept
+{
+    assert(groupSize > 0);
+
+    RucksackReport report;
+    ItemMask groupItems = ~ItemMask{ 0 };
+
+    std::ifstream file(filepath.data());
+    std::string line;
+    while(std::getline(file, line)) {
+        const std::string_view contents = line;
+        assert(contents.size() % 2 == 0);
+
+        const auto middle = contents.size() / 2;
+        const auto firstCompartment = itemMask(contents.substr(0, middle));
+        const auto secondCompartment = itemMask(contents.substr(middle));
+        report.duplicatePrioritiesSum += maskPrioritiesSum(firstCompartment & secondCompartment);
+
+        groupItems &= firstCompartment | secondCompartment;
+        ++report.rucksackCount;
+
+        if(report.rucksackCount % groupSize == 0) {
+            report.groupItemPrioritySum += groupItems == 0 ? 0 : std::countr_zero(groupItems);
+            ++report.groupCount;
+            groupItems = ~ItemMask{ 0 };
+        }
     }
 
-    rucksacks.pop_back();
+    report.ungroupedRucksacks = report.rucksackCount % groupSize;
 
-    return rucksacks;
+    return report;
 }
 
 int main()
 {
-    auto rucksacks = parseRucksacks("rucksacks_input.txt");
-
-    for(auto& r : rucksacks) {
-        r.findDuplicates();
-    }
+    constexpr size_t GroupSize = 3;
+    const auto report = evaluateRucksacks("rucksacks_input.txt", GroupSize);
 
-    const auto prioritiesSum = std::accumulate(rucksacks.begin(), rucksacks.end(), 0ULL, [](uint64_t v, const Rucksack& r){ return v + r.duplicatePrioritiesSum(); });
-    std::cout << std::format("The sum of the priorities of the items in both compartments is: {}\n", prioritiesSum);
+    std::cout << std::format("The sum of the priorities of the items in both compartments is: {}\n", report.duplicatePrioritiesSum);
 
     std::cout << "Part 2:\n";
 
-    uint64_t groupItemPrioritySum = 0;
-    for(size_t i = 0; i < rucksacks.size(); i += 3) {
-        const char groupItem = findGroupItem(rucksacks[i], rucksacks[i + 1], rucksacks[i + 2]);
-        groupItemPrioritySum += itemPriority(groupItem);
+    if(report.ungroupedRucksacks != 0) {
+        std::cerr << std::format("{} rucksacks are not a multiple of the group size {}, the last {} rucksacks are not part of a group.\n",
+                                 report.rucksackCount, GroupSize, report.ungroupedRucksacks);
     }
 
-    std::cout << std::format("The sum of the priorities of the group items is: {}\n", groupItemPrioritySum);
+    std::cout << std::format("The sum of the priorities of the group items is: {}\n", report.groupItemPrioritySum);
 
     return 0;
 }
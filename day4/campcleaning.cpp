@@ -1,15 +1,23 @@
 #include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <cstdint>
 #include <format>
-#include <fstream>
 #include <iostream>
-#include <regex>
+#include <limits>
+#include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <variant>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 struct Range {
     uint64_t lowerBound;
     uint64_t upperBound;
@@ -28,42 +36,316 @@ struct Range {
     }
 };
 
-using RangePair = std::pair<Range, Range>;
-bool oneContainsToOther(const RangePair& rangePair) noexcept
+// Range pairs stored as four columns so the counting loop streams through contiguous memory.
+template <typename Bound>
+struct RangePairColumns {
+    std::vector<Bound> lo1;
+    std::vector<Bound> hi1;
+    std::vector<Bound> lo2;
+    std::vector<Bound> hi2;
+
+    [[nodiscard]] size_t size() const noexcept { return lo1.size(); }
+
+    void reserve(size_t count) noexcept
+    {
+        lo1.reserve(count);
+        hi1.reserve(count);
+        lo2.reserve(count);
+        hi2.reserve(count);
+    }
+
+    void push(const Range& first, const Range& second) noexcept
+    {
+        lo1.emplace_back(static_cast<Bound>(first.lowerBound));
+        hi1.emplace_back(static_cast<Bound>(first.upperBound));
+        lo2.emplace_back(static_cast<Bound>(second.lowerBound));
+        hi2.emplace_back(static_cast<Bound>(second.upperBound));
+    }
+
+    [[nodiscard]] Range first(size_t i) const noexcept { return { lo1[i], hi1[i] }; }
+    [[nodiscard]] Range second(size_t i) const noexcept { return { lo2[i], hi2[i] }; }
+};
+
+using AnyRangePairColumns = std::variant<RangePairColumns<uint8_t>, RangePairColumns<uint16_t>, RangePairColumns<uint32_t>, RangePairColumns<uint64_t>>;
+
+template <typename Bound>
+RangePairColumns<Bound> narrowColumns(const RangePairColumns<uint64_t>& wide) noexcept
 {
-    return rangePair.first.contains(rangePair.second) | rangePair.second.contains(rangePair.first);
+    RangePairColumns<Bound> narrow;
+    narrow.reserve(wide.size());
+    for(size_t i = 0; i < wide.size(); ++i) {
+        narrow.push(wide.first(i), wide.second(i));
+    }
+    return narrow;
 }
 
-bool overlapEachOther(const RangePair& rangePair) noexcept
+// picks the narrowest bound type that can hold every bound, a narrower type means more pairs per vector register
+AnyRangePairColumns narrowestColumns(RangePairColumns<uint64_t>&& wide) noexcept
 {
-    return rangePair.first.containsAtLeastOneBound(rangePair.second) | rangePair.second.containsAtLeastOneBound(rangePair.first);
+    uint64_t maximum = 0;
+    for(const auto* column : { &wide.hi1, &wide.hi2 }) {
+        for(const auto bound : *column) {
+            maximum = std::max(maximum, bound);
+        }
+    }
+
+    if(maximum <= std::numeric_limits<uint8_t>::max()) {
+        return narrowColumns<uint8_t>(wide);
+    }
+    if(maximum <= std::numeric_limits<uint16_t>::max()) {
+        return narrowColumns<uint16_t>(wide);
+    }
+    if(maximum <= std::numeric_limits<uint32_t>::max()) {
+        return narrowColumns<uint32_t>(wide);
+    }
+    return std::move(wide);
 }
 
-std::vector<RangePair> parseCleaningInput(std::string_view filepath) noexcept
+struct PairCounts {
+    size_t containing = 0;
+    size_t overlapping = 0;
+};
+
+// Counts both answers in one pass. The loop body is branch free and only uses
+// same width comparisons, so the compiler can vectorize it over the bound type.
+template <typename Bound>
+PairCounts countContainingAndOverlapping(const RangePairColumns<Bound>& columns) noexcept
 {
-    std::vector<RangePair> result;
-    result.reserve(1024);
+    const Bound* lo1 = columns.lo1.data();
+    const Bound* hi1 = columns.hi1.data();
+    const Bound* lo2 = columns.lo2.data();
+    const Bound* hi2 = columns.hi2.data();
 
-    std::ifstream file(filepath.data());
-    std::string line;
+    PairCounts counts;
+    for(size_t i = 0; i < columns.size(); ++i) {
+        const bool firstContainsSecond = (lo1[i] <= lo2[i]) & (hi2[i] <= hi1[i]);
+        const bool secondContainsFirst = (lo2[i] <= lo1[i]) & (hi1[i] <= hi2[i]);
+        const bool overlap = (lo1[i] <= hi2[i]) & (lo2[i] <= hi1[i]);
+        counts.containing += firstContainsSecond | secondContainsFirst;
+        counts.overlapping += overlap;
+    }
+    return counts;
+}
 
-    std::string_view numberExpression = "([1-9][0-9]*)";
-    std::regex lineRegex(std::format("{0}-{0},{0}-{0}", numberExpression));
-    std::smatch subMatches;
+// Answers coverage questions over all assigned ranges. The build is a sweep over the
+// sorted range bounds that splits the sections into segments of constant coverage,
+// after that every point query is a binary search over the segments.
+struct SectionCoverageIndex {
+    // the coverage is segmentCoverage[i] from segmentBegins[i] up to segmentBegins[i + 1] - 1,
+    // the last segment always has coverage 0
+    std::vector<uint64_t> segmentBegins;
+    std::vector<size_t> segmentCoverage;
 
-    while(std::getline(file, line)) {
-        if(std::regex_match(line, subMatches, lineRegex)) [[likely]] {
-            assert(subMatches.size() == 5);
+    template <typename Bound>
+    void build(const RangePairColumns<Bound>& columns) noexcept;
 
-            result.emplace_back(Range{ std::stoull(subMatches[1].str()),  std::stoull(subMatches[2].str()) },
-                                 Range{ std::stoull(subMatches[3].str()), std::stoull(subMatches[4].str()) });
+    [[nodiscard]] size_t coverageAt(uint64_t section) const noexcept;
+    [[nodiscard]] std::vector<size_t> coverageAt(std::span<const uint64_t> sections) const noexcept;
+    [[nodiscard]] std::vector<Range> sectionsCoveredByMoreThan(size_t count) const noexcept;
+    // [coverage] -> number of sections with that coverage, between the first and the last assigned section
+    [[nodiscard]] std::vector<uint64_t> coverageHistogram() const noexcept;
+};
 
-            assert(result.back().first.valid());
-            assert(result.back().second.valid());
+template <typename Bound>
+void SectionCoverageIndex::build(const RangePairColumns<Bound>& columns) noexcept
+{
+    std::vector<uint64_t> lowerBounds;
+    std::vector<uint64_t> upperBounds;
+    lowerBounds.reserve(2 * columns.size());
+    upperBounds.reserve(2 * columns.size());
+    lowerBounds.insert(lowerBounds.end(), columns.lo1.begin(), columns.lo1.end());
+    lowerBounds.insert(lowerBounds.end(), columns.lo2.begin(), columns.lo2.end());
+    upperBounds.insert(upperBounds.end(), columns.hi1.begin(), columns.hi1.end());
+    upperBounds.insert(upperBounds.end(), columns.hi2.begin(), columns.hi2.end());
+    std::ranges::sort(lowerBounds);
+    std::ranges::sort(upperBounds);
+
+    segmentBegins.clear();
+    segmentCoverage.clear();
+
+    // a range ends in front of upperBound + 1, all lower bounds are reached before their upper bounds
+    size_t coverage = 0;
+    auto lowerIt = lowerBounds.begin();
+    auto upperIt = upperBounds.begin();
+    while(upperIt != upperBounds.end()) {
+        const uint64_t position = lowerIt != lowerBounds.end() ? std::min(*lowerIt, *upperIt + 1) : *upperIt + 1;
+        for(; lowerIt != lowerBounds.end() && *lowerIt == position; ++lowerIt) {
+            ++coverage;
+        }
+        for(; upperIt != upperBounds.end() && *upperIt + 1 == position; ++upperIt) {
+            --coverage;
+        }
+        segmentBegins.emplace_back(position);
+        segmentCoverage.emplace_back(coverage);
+    }
+}
+
+size_t SectionCoverageIndex::coverageAt(uint64_t section) const noexcept
+{
+    const auto segmentIt = std::ranges::upper_bound(segmentBegins, section);
+    if(segmentIt == segmentBegins.begin()) {
+        return 0;
+    }
+    return segmentCoverage[std::distance(segmentBegins.begin(), segmentIt) - 1];
+}
+
+std::vector<size_t> SectionCoverageIndex::coverageAt(std::span<const uint64_t> sections) const noexcept
+{
+    std::vector<size_t> result;
+    result.reserve(sections.size());
+    for(const auto section : sections) {
+        result.emplace_back(coverageAt(section));
+    }
+    return result;
+}
+
+std::vector<Range> SectionCoverageIndex::sectionsCoveredByMoreThan(size_t count) const noexcept
+{
+    std::vector<Range> result;
+    for(size_t i = 0; i + 1 < segmentBegins.size(); ++i) {
+        if(segmentCoverage[i] <= count) {
+            continue;
+        }
+        const Range segment{ segmentBegins[i], segmentBegins[i + 1] - 1 };
+        if(not result.empty() && result.back().upperBound + 1 == segment.lowerBound) {
+            result.back().upperBound = segment.upperBound;
         }
         else {
-            assert(false && "Unexpected input format.");
+            result.emplace_back(segment);
+        }
+    }
+    return result;
+}
+
+std::vector<uint64_t> SectionCoverageIndex::coverageHistogram() const noexcept
+{
+    std::vector<uint64_t> histogram;
+    for(size_t i = 0; i + 1 < segmentBegins.size(); ++i) {
+        if(histogram.size() <= segmentCoverage[i]) {
+            histogram.resize(segmentCoverage[i] + 1, 0);
         }
+        histogram[segmentCoverage[i]] += segmentBegins[i + 1] - segmentBegins[i];
+    }
+    return histogram;
+}
+
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    bool valid = false;
+
+    explicit MappedFile(std::string_view filepath) noexcept;
+    ~MappedFile() noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::string_view view() const noexcept { return { data, size }; }
+};
+
+MappedFile::MappedFile(std::string_view filepath) noexcept
+{
+    const int fd = open(filepath.data(), O_RDONLY);
+    if(fd < 0) {
+        return;
+    }
+
+    struct stat fileStat{};
+    if(fstat(fd, &fileStat) == 0) {
+        size = static_cast<size_t>(fileStat.st_size);
+        if(size == 0) {
+            valid = true;
+        }
+        else if(void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0); mapped != MAP_FAILED) {
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapped);
+            valid = true;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() noexcept
+{
+    if(data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+// Parses a section number without leading zeros and advances it past the number.
+bool parseSection(const char*& it, const char* end, uint64_t& section) noexcept
+{
+    if(it == end || *it < '1' || *it > '9') {
+        return false;
+    }
+    const auto [ptr, ec] = std::from_chars(it, end, section);
+    it = ptr;
+    return ec == std::errc{};
+}
+
+bool expect(const char*& it, const char* end, char expected) noexcept
+{
+    if(it == end || *it != expected) {
+        return false;
+    }
+    ++it;
+    return true;
+}
+
+// Parses one "a-b,c-d" line. Nothing is allocated, the bounds are written straight into the columns.
+bool parseAssignmentLine(std::string_view line, RangePairColumns<uint64_t>& result) noexcept
+{
+    const char* it = line.data();
+    const char* end = it + line.size();
+
+    Range first{};
+    Range second{};
+    const bool parsed = parseSection(it, end, first.lowerBound)
+        && expect(it, end, '-')
+        && parseSection(it, end, first.upperBound)
+        && expect(it, end, ',')
+        && parseSection(it, end, second.lowerBound)
+        && expect(it, end, '-')
+        && parseSection(it, end, second.upperBound)
+        && it == end;
+
+    if(not parsed || not first.valid() || not second.valid()) {
+        return false;
+    }
+
+    result.push(first, second);
+    return true;
+}
+
+std::optional<RangePairColumns<uint64_t>> parseCleaningInput(std::string_view filepath) noexcept
+{
+    const MappedFile file(filepath);
+    if(not file.valid) {
+        std::cerr << std::format("Cannot open {}.\n", filepath);
+        return std::nullopt;
+    }
+
+    const std::string_view data = file.view();
+
+    RangePairColumns<uint64_t> result;
+    // every line has at least 8 bytes, "a-b,c-d" plus the line break
+    result.reserve(data.size() / 8 + 1);
+
+    size_t lineNumber = 0;
+    size_t lineBegin = 0;
+    while(lineBegin < data.size()) {
+        size_t lineEnd = data.find('\n', lineBegin);
+        if(lineEnd == std::string_view::npos) {
+            lineEnd = data.size();
+        }
+        ++lineNumber;
+
+        const auto line = data.substr(lineBegin, lineEnd - lineBegin);
+        if(not parseAssignmentLine(line, result)) [[unlikely]] {
+            std::cerr << std::format("Unexpected input format in line {}: \"{}\"\n", lineNumber, line);
+            return std::nullopt;
+        }
+
+        lineBegin = lineEnd + 1;
     }
 
     std::cout << std::format("Parsed {} pairs of ranges\n", result.size());
@@ -73,17 +355,42 @@ std::vector<RangePair> parseCleaningInput(std::string_view filepath) noexcept
 
 int main()
 {
-    const auto rangePairs = parseCleaningInput("campcleaning_input.txt");
+    auto parsedRangePairs = parseCleaningInput("campcleaning_input.txt");
+    if(not parsedRangePairs.has_value()) {
+        return 1;
+    }
 
-    const auto containsOtherCount = std::ranges::count_if(rangePairs, &oneContainsToOther);
+    const auto rangePairs = narrowestColumns(std::move(*parsedRangePairs));
+    const auto counts = std::visit([](const auto& columns) { return countContainingAndOverlapping(columns); }, rangePairs);
 
-    std::cout << std::format("There are {} assigned range pairs where one contains the other range.\n", containsOtherCount);
+    std::cout << std::format("There are {} assigned range pairs where one contains the other range.\n", counts.containing);
 
     std::cout << "Part 2:\n";
 
-    const auto overlapCount = std::ranges::count_if(rangePairs, &overlapEachOther);
+    std::cout << std::format("There are {} assigned range pairs that overlap with each other.\n", counts.overlapping);
+
+    SectionCoverageIndex coverageIndex;
+    std::visit([&coverageIndex](const auto& columns) { coverageIndex.build(columns); }, rangePairs);
+
+    const auto histogram = coverageIndex.coverageHistogram();
+    // the last histogram entry is the highest coverage, there is none without any assigned section
+    if(histogram.size() >= 2) {
+        const auto busiestSections = coverageIndex.sectionsCoveredByMoreThan(histogram.size() - 2);
+        const auto busiestSection = busiestSections.front().lowerBound;
+        std::cout << std::format("The busiest sections are assigned to {} elfs, starting at section {}.\n",
+                                 coverageIndex.coverageAt(busiestSection), busiestSection);
 
-    std::cout << std::format("There are {} assigned range pairs that overlap with each other.\n", overlapCount);
+        // how many elfs share the sections right around the busiest one
+        constexpr uint64_t Neighbourhood = 2;
+        std::vector<uint64_t> sections;
+        for(uint64_t section = busiestSection - std::min(busiestSection, Neighbourhood); section <= busiestSection + Neighbourhood; ++section) {
+            sections.emplace_back(section);
+        }
+        const auto coverage = coverageIndex.coverageAt(sections);
+        for(size_t i = 0; i < sections.size(); ++i) {
+            std::cout << std::format("    section {:3} is assigned to {} elfs\n", sections[i], coverage[i]);
+        }
+    }
 
     return 0;
 }
@@ -1,95 +1,357 @@
 #include <algorithm>
-#include <array>
 #include <cassert>
+#include <charconv>
 #include <cstdint>
+#include <cstdlib>
 #include <format>
 #include <fstream>
 #include <iostream>
-#include <regex>
+#include <iterator>
+#include <limits>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
-struct Stack {
-    std::vector<char> crates;
+struct Command {
+    size_t source;
+    size_t destination;
+    std::ptrdiff_t count;
+};
 
-    char take() noexcept
-    {
-        assert(not crates.empty());
-        const char crate = crates.back();
-        crates.pop_back();
-        return crate;
+enum class CraneModel {
+    CrateMover9000,
+    CrateMover9001
+};
+
+// Node ids index the shared pool, the largest id marks a missing node.
+using NodeId = uint32_t;
+constexpr NodeId NoNode = std::numeric_limits<NodeId>::max();
+
+// One crate in an implicit treap. The in-order sequence of a treap is its stack from the bottom to the top.
+struct CrateNode {
+    NodeId left = NoNode;
+    NodeId right = NoNode;
+    uint32_t size = 1;
+    uint32_t priority = 0;
+    char crate = ' ';
+    // the order of the whole subtree is reversed, not yet pushed down to the children
+    bool reversed = false;
+};
+
+// All stacks share one node pool, a stack is the root of its treap. Moving the top crates of a stack
+// is a split and a merge, the CrateMover 9000 order is a lazy reverse flag on the moved subtree.
+// The treaps are persistent: nodes are copied along the changed paths instead of being modified,
+// so the root of an older version of a stack stays valid after later transfers.
+struct Stacks {
+    std::vector<CrateNode> nodes;
+    std::vector<NodeId> roots;
+
+    explicit Stacks(size_t stackCount = 0) noexcept : roots(stackCount, NoNode) {}
+
+    [[nodiscard]] size_t size() const noexcept { return roots.size(); }
+    [[nodiscard]] size_t height(size_t stack) const noexcept { return heightOf(roots[stack]); }
+    [[nodiscard]] char top(size_t stack) const noexcept { return topOf(roots[stack]); }
+    // index 0 is the bottom crate
+    [[nodiscard]] char crateAt(size_t stack, size_t index) const noexcept { return crateOf(roots[stack], index); }
+    // all crates of the stack from the bottom to the top
+    [[nodiscard]] std::string crates(size_t stack) const noexcept { return cratesOf(roots[stack]); }
+
+    // the same queries on any version of a stack
+    [[nodiscard]] size_t heightOf(NodeId root) const noexcept { return root == NoNode ? 0 : nodes[root].size; }
+    [[nodiscard]] char topOf(NodeId root) const noexcept;
+    [[nodiscard]] char crateOf(NodeId root, size_t index) const noexcept;
+    [[nodiscard]] std::string cratesOf(NodeId root) const noexcept;
+
+    void place(size_t stack, char crate) noexcept;
+    // reversed moves the crates one at a time, otherwise they keep their order
+    void transferCrates(size_t source, size_t destination, size_t count, bool reversed) noexcept;
+
+private:
+    void appendCrates(NodeId node, bool reversed, std::string& result) const noexcept;
+    NodeId addNode(const CrateNode& node) noexcept;
+    NodeId copy(NodeId node) noexcept;
+    void update(NodeId node) noexcept;
+    void pushDown(NodeId node) noexcept;
+    std::pair<NodeId, NodeId> split(NodeId node, size_t leftCount) noexcept;
+    NodeId merge(NodeId left, NodeId right) noexcept;
+};
+
+char Stacks::topOf(NodeId root) const noexcept
+{
+    NodeId node = root;
+    assert(node != NoNode);
+
+    // follow the last crate in order without pushing the reverse flags down
+    bool reversed = false;
+    while(true) {
+        reversed ^= nodes[node].reversed;
+        const NodeId next = reversed ? nodes[node].left : nodes[node].right;
+        if(next == NoNode) {
+            return nodes[node].crate;
+        }
+        node = next;
     }
+}
 
-    void place(char crate) noexcept
-    {
-        crates.emplace_back(crate);
+char Stacks::crateOf(NodeId root, size_t index) const noexcept
+{
+    assert(index < heightOf(root));
+
+    NodeId node = root;
+    bool reversed = false;
+    while(true) {
+        reversed ^= nodes[node].reversed;
+        const NodeId lower = reversed ? nodes[node].right : nodes[node].left;
+        const NodeId upper = reversed ? nodes[node].left : nodes[node].right;
+        const size_t lowerSize = heightOf(lower);
+        if(index == lowerSize) {
+            return nodes[node].crate;
+        }
+        if(index < lowerSize) {
+            node = lower;
+        }
+        else {
+            index -= lowerSize + 1;
+            node = upper;
+        }
     }
+}
 
-    char top() const noexcept
-    {
-        assert(not crates.empty());
-        return crates.back();
+std::string Stacks::cratesOf(NodeId root) const noexcept
+{
+    std::string result;
+    result.reserve(heightOf(root));
+    appendCrates(root, false, result);
+    return result;
+}
+
+void Stacks::appendCrates(NodeId node, bool reversed, std::string& result) const noexcept
+{
+    if(node == NoNode) {
+        return;
     }
+    reversed ^= nodes[node].reversed;
+    appendCrates(reversed ? nodes[node].right : nodes[node].left, reversed, result);
+    result.push_back(nodes[node].crate);
+    appendCrates(reversed ? nodes[node].left : nodes[node].right, reversed, result);
+}
 
-    void transferCratesTo(Stack& destination, ptrdiff_t count) noexcept
-    {
-        auto moveBeginIt = crates.end() - count;
-        destination.crates.insert(destination.crates.end(), moveBeginIt, crates.end());
-        crates.erase(moveBeginIt, crates.end());
+void Stacks::place(size_t stack, char crate) noexcept
+{
+    // splitmix style hash of the node index, deterministic but well spread priorities
+    uint64_t hash = (nodes.size() + 1) * 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+
+    roots[stack] = merge(roots[stack], addNode(CrateNode{ .priority = static_cast<uint32_t>(hash >> 32), .crate = crate }));
+}
+
+void Stacks::transferCrates(size_t source, size_t destination, size_t count, bool reversed) noexcept
+{
+    assert(count <= height(source));
+
+    // taking crates off a stack and putting them back on it leaves the stack as it was, in both orders
+    if(source == destination) {
+        return;
     }
-};
 
-struct Command {
-    size_t source;
-    size_t destination;
-    std::ptrdiff_t count;
-};
+    // the roots returned by split are fresh copies, so flipping the flag does not touch older versions
+    auto [remaining, moved] = split(roots[source], height(source) - count);
+    if(reversed & (moved != NoNode)) {
+        nodes[moved].reversed ^= true;
+    }
+    roots[source] = remaining;
+    roots[destination] = merge(roots[destination], moved);
+}
+
+NodeId Stacks::copy(NodeId node) noexcept
+{
+    // copied by value, the reference into nodes would dangle when the pool grows
+    return addNode(CrateNode{ nodes[node] });
+}
+
+NodeId Stacks::addNode(const CrateNode& node) noexcept
+{
+    // older versions are never freed, so the pool only grows with every transfer
+    if(nodes.size() >= NoNode) {
+        std::cerr << std::format("The crate node pool is full with {} nodes.\n", nodes.size());
+        std::abort();
+    }
+    nodes.emplace_back(node);
+    return static_cast<NodeId>(nodes.size() - 1);
+}
+
+void Stacks::update(NodeId node) noexcept
+{
+    nodes[node].size = static_cast<uint32_t>(1 + heightOf(nodes[node].left) + heightOf(nodes[node].right));
+}
+
+// node has to be a fresh copy, its children are copied before their flags change
+void Stacks::pushDown(NodeId node) noexcept
+{
+    if(not nodes[node].reversed) {
+        return;
+    }
+
+    const NodeId left = nodes[node].right == NoNode ? NoNode : copy(nodes[node].right);
+    const NodeId right = nodes[node].left == NoNode ? NoNode : copy(nodes[node].left);
+    for(const NodeId child : { left, right }) {
+        if(child != NoNode) {
+            nodes[child].reversed ^= true;
+        }
+    }
+
+    nodes[node].left = left;
+    nodes[node].right = right;
+    nodes[node].reversed = false;
+}
+
+std::pair<NodeId, NodeId> Stacks::split(NodeId node, size_t leftCount) noexcept
+{
+    if(node == NoNode) {
+        return { NoNode, NoNode };
+    }
+    node = copy(node);
+    pushDown(node);
+
+    if(heightOf(nodes[node].left) >= leftCount) {
+        const auto [left, right] = split(nodes[node].left, leftCount);
+        nodes[node].left = right;
+        update(node);
+        return { left, node };
+    }
+
+    const auto [left, right] = split(nodes[node].right, leftCount - heightOf(nodes[node].left) - 1);
+    nodes[node].right = left;
+    update(node);
+    return { node, right };
+}
+
+NodeId Stacks::merge(NodeId left, NodeId right) noexcept
+{
+    if(left == NoNode) {
+        return right;
+    }
+    if(right == NoNode) {
+        return left;
+    }
+
+    if(nodes[left].priority > nodes[right].priority) {
+        left = copy(left);
+        pushDown(left);
+        const NodeId merged = merge(nodes[left].right, right);
+        nodes[left].right = merged;
+        update(left);
+        return left;
+    }
+
+    right = copy(right);
+    pushDown(right);
+    const NodeId merged = merge(left, nodes[right].left);
+    nodes[right].left = merged;
+    update(right);
+    return right;
+}
 
-using Stacks = std::array<Stack, 9>;
 using Commands = std::vector<Command>;
 
-std::pair<Stacks, Commands> parseStacksAndCommands(std::string_view filepath) noexcept
+// Reads the next unsigned number and advances past it, leading spaces are skipped.
+bool scanNumber(std::string_view& text, size_t& number) noexcept
 {
-    Stacks stacks;
+    const auto begin = text.find_first_not_of(' ');
+    if(begin == std::string_view::npos) {
+        return false;
+    }
+    const auto [ptr, ec] = std::from_chars(text.data() + begin, text.data() + text.size(), number);
+    if(ec != std::errc{}) {
+        return false;
+    }
+    text.remove_prefix(static_cast<size_t>(ptr - text.data()));
+    return true;
+}
+
+bool scanWord(std::string_view& text, std::string_view word) noexcept
+{
+    const auto begin = text.find_first_not_of(' ');
+    if(begin == std::string_view::npos || text.substr(begin, word.size()) != word) {
+        return false;
+    }
+    text.remove_prefix(begin + word.size());
+    return true;
+}
+
+// "move <count> from <source> to <destination>" with 1 based stack ids
+std::optional<Command> parseCommand(std::string_view line, size_t stackCount) noexcept
+{
+    size_t count = 0;
+    size_t source = 0;
+    size_t destination = 0;
+    const bool parsed = scanWord(line, "move") && scanNumber(line, count)
+        && scanWord(line, "from") && scanNumber(line, source)
+        && scanWord(line, "to") && scanNumber(line, destination)
+        && line.find_first_not_of(' ') == std::string_view::npos;
+
+    const bool validStacks = (source >= 1) & (source <= stackCount) & (destination >= 1) & (destination <= stackCount);
+    if(not parsed || not validStacks) {
+        return std::nullopt;
+    }
+    return Command{ source - 1, destination - 1, static_cast<std::ptrdiff_t>(count) };
+}
 
+// Reports the first malformed command with its line number, returns nullopt then.
+std::optional<std::pair<Stacks, Commands>> parseStacksAndCommands(std::string_view filepath) noexcept
+{
     std::ifstream file(filepath.data());
-    {
-        std::regex baseRegex(" 1   2   3   4   5   6   7   8   9 ");
+    if(not file) {
+        std::cerr << std::format("Cannot open {}.\n", filepath);
+        return std::nullopt;
+    }
 
-        std::vector<std::string> lines;
-        lines.reserve(16);
-        lines.emplace_back();
+    // line breaks may be CRLF, the '\r' would end up in the crates and commands otherwise
+    size_t lineNumber = 0;
+    const auto readLine = [&](std::string& line) {
+        if(not std::getline(file, line)) {
+            return false;
+        }
+        if(line.ends_with('\r')) {
+            line.pop_back();
+        }
+        ++lineNumber;
+        return true;
+    };
 
-        while (std::getline(file, lines.back())) {
-            // find index line
-            if(std::regex_match(lines.back(), baseRegex)) {
-                std::getline(file, lines.back());
-                lines.pop_back();
-                break;
-            }
-            else {
-                lines.emplace_back();
+    std::vector<std::string> lines;
+    lines.reserve(16);
+    lines.emplace_back();
+
+    size_t stackCount = 0;
+    while (readLine(lines.back())) {
+        // the index line is the first line that starts with a stack number
+        std::string_view indexLine = lines.back();
+        const auto firstNonSpace = indexLine.find_first_not_of(' ');
+        if(firstNonSpace != std::string_view::npos && indexLine[firstNonSpace] != '[') {
+            for(size_t index = 0; scanNumber(indexLine, index);) {
+                stackCount = index;
             }
+            // skip the empty line after the index line
+            readLine(lines.back());
+            lines.pop_back();
+            break;
         }
-        // we need to insert from the bottom up
-        std::ranges::reverse(lines);
-
-        std::string_view crateRegex = "((   )|(\\[[A-Z]\\]))";
-        std::regex crateLineRegex(std::format("{0} {0} {0} {0} {0} {0} {0} {0} {0}", crateRegex));
-        std::smatch subMatches;
-        for(const auto& line : lines) {
-            const bool matched = std::regex_match(line, subMatches, crateLineRegex);
-            assert(matched && "Expected match failed");
-            assert(subMatches.size() == 28);
-            for(int i = 0; i < 9; ++i) {
-                const auto subMatchIndex = i * 3
-                    + 1     // phrase match
-                    + 2;    // third submatch in submatch block
-                if(subMatches[subMatchIndex].matched) {
-                    stacks[i].place(subMatches[subMatchIndex].str()[1]);
-                }
+        lines.emplace_back();
+    }
+
+    // every stack occupies 4 columns "[X] ", the crate letter is at column 4 * i + 1
+    Stacks stacks(stackCount);
+    for(auto it = lines.rbegin(); it != lines.rend(); ++it) {
+        const auto& line = *it;
+        for(size_t i = 0; i < stackCount && 4 * i + 1 < line.size(); ++i) {
+            const char crate = line[4 * i + 1];
+            if(crate != ' ') {
+                stacks.place(i, crate);
             }
         }
     }
@@ -97,73 +359,168 @@ std::pair<Stacks, Commands> parseStacksAndCommands(std::string_view filepath) no
     Commands commands;
     commands.reserve(1024);
 
-    {
-        std::regex commandRegex("move ([1-9][0-9]*) from ([1-9]) to ([1-9])");
-        std::smatch subMatches;
-
-        std::string line;
-        while (std::getline(file, line)) {
-            const auto matched = std::regex_match(line, subMatches, commandRegex);
-            assert(matched);
-            assert(subMatches.size() == 4);
-            commands.emplace_back(std::stoull(subMatches[2].str()) - 1,
-                                  std::stoull(subMatches[3].str()) - 1,
-                                  std::stoll(subMatches[1].str()));
+    std::string line;
+    while (readLine(line)) {
+        if(line.empty()) {
+            continue;
+        }
+        const auto command = parseCommand(line, stackCount);
+        if(not command.has_value()) [[unlikely]] {
+            std::cerr << std::format("Unexpected input format in line {}: \"{}\"\n", lineNumber, line);
+            return std::nullopt;
         }
+        commands.emplace_back(*command);
     }
 
-    return { stacks, commands };
+    return std::pair{ std::move(stacks), std::move(commands) };
 }
 
 void executeCommandCrateMover9000(const Command& command, Stacks& stacks) noexcept
 {
-    auto& sourceStack = stacks[command.source];
-    auto& destinationStack = stacks[command.destination];
+    stacks.transferCrates(command.source, command.destination, static_cast<size_t>(command.count), true);
+}
 
-    for(std::ptrdiff_t i = 0; i < command.count; ++i) {
-        destinationStack.place(sourceStack.take());
+void executeCommandCrateMover9001(const Command& command, Stacks& stacks) noexcept
+{
+    stacks.transferCrates(command.source, command.destination, static_cast<size_t>(command.count), false);
+}
+
+// The yard after every command. Only the roots of the two stacks a command touches are
+// recorded, the persistent treaps keep every older version of a stack intact.
+struct StacksHistory {
+    Stacks stacks;
+    // versions[stack] holds (executed commands, root) pairs in command order
+    std::vector<std::vector<std::pair<size_t, NodeId>>> versions;
+    size_t commandCount = 0;
+
+    StacksHistory(Stacks initial, const Commands& commands, CraneModel model) noexcept;
+
+    // executedCommands = 0 is the initial yard
+    [[nodiscard]] NodeId rootAt(size_t executedCommands, size_t stack) const noexcept;
+    [[nodiscard]] char top(size_t executedCommands, size_t stack) const noexcept;
+    [[nodiscard]] std::string tops(size_t executedCommands) const noexcept;
+    [[nodiscard]] std::string crates(size_t executedCommands, size_t stack) const noexcept;
+};
+
+StacksHistory::StacksHistory(Stacks initial, const Commands& commands, CraneModel model) noexcept
+    : stacks(std::move(initial))
+    , versions(stacks.size())
+    , commandCount(commands.size())
+{
+    for(size_t stack = 0; stack < stacks.size(); ++stack) {
+        versions[stack].emplace_back(0, stacks.roots[stack]);
+    }
+
+    for(size_t i = 0; i < commands.size(); ++i) {
+        const auto& command = commands[i];
+        if(model == CraneModel::CrateMover9000) {
+            executeCommandCrateMover9000(command, stacks);
+        }
+        else {
+            executeCommandCrateMover9001(command, stacks);
+        }
+        versions[command.source].emplace_back(i + 1, stacks.roots[command.source]);
+        versions[command.destination].emplace_back(i + 1, stacks.roots[command.destination]);
     }
 }
 
-void executeCommandCrateMover9001(const Command& command, Stacks& stacks) noexcept
+NodeId StacksHistory::rootAt(size_t executedCommands, size_t stack) const noexcept
 {
-    auto& sourceStack = stacks[command.source];
-    auto& destinationStack = stacks[command.destination];
+    assert(executedCommands <= commandCount);
 
-    sourceStack.transferCratesTo(destinationStack, command.count);
+    const auto& stackVersions = versions[stack];
+    const auto it = std::ranges::upper_bound(stackVersions, executedCommands, {}, &std::pair<size_t, NodeId>::first);
+    return std::prev(it)->second;
 }
 
-int main()
+char StacksHistory::top(size_t executedCommands, size_t stack) const noexcept
 {
-    const auto [ stacks, commands ] = parseStacksAndCommands("cratestacking_input");
+    const NodeId root = rootAt(executedCommands, stack);
+    return root == NoNode ? ' ' : stacks.topOf(root);
+}
 
-    {
-        auto stacks9000 = stacks;
+std::string StacksHistory::tops(size_t executedCommands) const noexcept
+{
+    std::string result(stacks.size(), ' ');
+    for(size_t stack = 0; stack < stacks.size(); ++stack) {
+        result[stack] = top(executedCommands, stack);
+    }
+    return result;
+}
 
-        for (const auto& command : commands) {
-            executeCommandCrateMover9000(command, stacks9000);
-        }
+std::string StacksHistory::crates(size_t executedCommands, size_t stack) const noexcept
+{
+    return stacks.cratesOf(rootAt(executedCommands, stack));
+}
 
-        std::cout << "The top crates are (CrateMover 9000): ";
-        for (const auto& stack : stacks9000) {
-            std::cout << stack.top();
-        }
-        std::cout << "\n";
+// Finds the top crates without moving any crate. Every final top position is traced backward
+// through the commands to its position in the initial stacks, only the stack heights are replayed.
+std::string resolveTopCrates(const Stacks& stacks, const Commands& commands, CraneModel model) noexcept
+{
+    std::vector<size_t> finalHeights(stacks.size());
+    for(size_t i = 0; i < stacks.size(); ++i) {
+        finalHeights[i] = stacks.height(i);
+    }
+    for(const auto& command : commands) {
+        finalHeights[command.source] -= command.count;
+        finalHeights[command.destination] += command.count;
     }
 
+    std::string tops(stacks.size(), ' ');
     {
-        auto stacks9001 = stacks;
+        std::vector<std::jthread> threads;
+        threads.reserve(stacks.size());
+        for(size_t stack = 0; stack < stacks.size(); ++stack) {
+            threads.emplace_back([&, stack]() {
+                // an empty stack keeps a space as its top
+                if(finalHeights[stack] == 0) {
+                    return;
+                }
 
-        for (const auto& command : commands) {
-            executeCommandCrateMover9001(command, stacks9001);
-        }
+                auto heights = finalHeights;
+                size_t position = stack;
+                size_t index = heights[stack] - 1;
+
+                for(auto it = commands.rbegin(); it != commands.rend(); ++it) {
+                    // a move onto the same stack leaves it unchanged
+                    if(it->source == it->destination) {
+                        continue;
+                    }
+                    const auto count = static_cast<size_t>(it->count);
+                    const size_t movedBegin = heights[it->destination] - count;
+                    heights[it->destination] -= count;
+                    heights[it->source] += count;
+
+                    if(position == it->destination && index >= movedBegin) {
+                        const size_t offset = index - movedBegin;
+                        const size_t sourceBegin = heights[it->source] - count;
+                        index = model == CraneModel::CrateMover9000 ? heights[it->source] - 1 - offset : sourceBegin + offset;
+                        position = it->source;
+                    }
+                }
 
-        std::cout << "The top crates are (CrateMover 9001): ";
-        for (const auto& stack : stacks9001) {
-            std::cout << stack.top();
+                tops[stack] = stacks.crateAt(position, index);
+            });
         }
-        std::cout << "\n";
     }
 
+    return tops;
+}
+
+int main()
+{
+    const auto parsed = parseStacksAndCommands("cratestacking_input");
+    if(not parsed.has_value()) {
+        return 1;
+    }
+    const auto& [ stacks, commands ] = *parsed;
+
+    std::cout << std::format("The top crates are (CrateMover 9000): {}\n", resolveTopCrates(stacks, commands, CraneModel::CrateMover9000));
+    std::cout << std::format("The top crates are (CrateMover 9001): {}\n", resolveTopCrates(stacks, commands, CraneModel::CrateMover9001));
+
+    const StacksHistory history9001(stacks, commands, CraneModel::CrateMover9001);
+    const size_t halfway = commands.size() / 2;
+    std::cout << std::format("After {} of {} commands the top crates are (CrateMover 9001): {}\n", halfway, commands.size(), history9001.tops(halfway));
+
     return 0;
 }
@@ -1,47 +1,284 @@
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
 #include <cstdint>
 #include <format>
-#include <fstream>
 #include <iostream>
-#include <string>
+#include <span>
 #include <string_view>
+#include <thread>
+#include <vector>
 
-int findFirstConsecutiveUniqueByteChain(const std::string& data, int consecutiveCount) noexcept
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A window longer than the byte alphabet always contains a duplicate.
+constexpr size_t MaximumWindowSize = 256;
+constexpr size_t XorMaskMaximumWindowSize = 64;
+
+// Every byte flips its bit when it enters and when it leaves the window. A byte that occurs
+// an even number of times clears its bit, so the window is unique exactly when the number
+// of set bits equals the window size.
+int64_t findFirstMarkerXorMask(std::string_view data, size_t windowSize) noexcept
+{
+    std::array<uint64_t, 4> mask{};
+    const auto flip = [&mask](char byte) {
+        const auto value = static_cast<uint8_t>(byte);
+        mask[value >> 6] ^= uint64_t{ 1 } << (value & 63);
+    };
+
+    for(size_t i = 0; i < data.size(); ++i) {
+        flip(data[i]);
+        if(i >= windowSize) {
+            flip(data[i - windowSize]);
+        }
+
+        const auto uniqueCount = std::popcount(mask[0]) + std::popcount(mask[1]) + std::popcount(mask[2]) + std::popcount(mask[3]);
+        if(static_cast<size_t>(uniqueCount) == windowSize) {
+            return static_cast<int64_t>(i + 1);
+        }
+    }
+
+    return -1;
+}
+
+// Keeps the count of every byte in the window and the number of distinct bytes.
+int64_t findFirstMarkerCounts(std::string_view data, size_t windowSize) noexcept
+{
+    std::array<uint32_t, 256> counts{};
+    size_t distinct = 0;
+
+    for(size_t i = 0; i < data.size(); ++i) {
+        distinct += counts[static_cast<uint8_t>(data[i])]++ == 0;
+        if(i >= windowSize) {
+            distinct -= --counts[static_cast<uint8_t>(data[i - windowSize])] == 0;
+        }
+
+        if(distinct == windowSize) {
+            return static_cast<int64_t>(i + 1);
+        }
+    }
+
+    return -1;
+}
+
+// Returns the position right after the first window of unique bytes or -1, O(n) for every window size.
+template <size_t WindowSize>
+    requires (WindowSize >= 1)
+int64_t findFirstMarker(std::string_view data) noexcept
+{
+    if constexpr (WindowSize > MaximumWindowSize) {
+        return -1;
+    }
+    else if constexpr (WindowSize <= XorMaskMaximumWindowSize) {
+        return findFirstMarkerXorMask(data, WindowSize);
+    }
+    else {
+        return findFirstMarkerCounts(data, WindowSize);
+    }
+}
+
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    bool valid = false;
+
+    explicit MappedFile(std::string_view filepath) noexcept;
+    ~MappedFile() noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::string_view view() const noexcept { return { data, size }; }
+};
+
+MappedFile::MappedFile(std::string_view filepath) noexcept
 {
-    const int consecutiveMinusOne = consecutiveCount - 1;
+    const int fd = open(filepath.data(), O_RDONLY);
+    if(fd < 0) {
+        return;
+    }
 
-    for(int i = consecutiveMinusOne; i < data.size(); ++i) {
-        std::string_view subData{ &data[i - consecutiveMinusOne], static_cast<size_t>(consecutiveCount) };
-        bool beginningFound = true;
+    struct stat fileStat{};
+    if(fstat(fd, &fileStat) == 0) {
+        size = static_cast<size_t>(fileStat.st_size);
+        if(size == 0) {
+            valid = true;
+        }
+        else if(void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0); mapped != MAP_FAILED) {
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapped);
+            valid = true;
+        }
+    }
+    close(fd);
+}
 
-        for(int j = 0; (j < subData.size() - 1) & beginningFound; ++j) {
-            for(int k = j + 1; k < subData.size(); ++k) {
-                if(subData[j] == subData[k]) {
-                    beginningFound = false;
-                    break;
+MappedFile::~MappedFile() noexcept
+{
+    if(data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+// Reports every marker of every window size in a single pass. The longest run of unique bytes
+// that ends at the current byte is tracked with the last position of every byte value, a window
+// of size w ends at the current byte when that run is at least w bytes long.
+// onMarker(windowIndex, position) is called with the position right after the marker and
+// returns false to stop the scan. positionOffset is added to every reported position.
+template <typename MarkerCallback>
+void scanMarkers(std::string_view data, std::span<const size_t> windowSizes, MarkerCallback&& onMarker, uint64_t positionOffset = 0) noexcept
+{
+    // last position + 1 of every byte value, 0 for not seen yet
+    std::array<uint64_t, 256> lastSeenEnd{};
+    uint64_t uniqueBegin = 0;
+
+    for(uint64_t i = 0; i < data.size(); ++i) {
+        auto& seenEnd = lastSeenEnd[static_cast<uint8_t>(data[i])];
+        uniqueBegin = std::max(uniqueBegin, seenEnd);
+        seenEnd = i + 1;
+
+        const uint64_t uniqueLength = i + 1 - uniqueBegin;
+        for(size_t w = 0; w < windowSizes.size(); ++w) {
+            if(uniqueLength >= windowSizes[w] && not onMarker(w, positionOffset + i + 1)) {
+                return;
+            }
+        }
+    }
+}
+
+// Searches chunks of the stream on all threads, every chunk is scanned once for all window sizes. The
+// scan of a chunk starts early by the largest window size - 1, so that markers crossing a chunk border
+// are found, and stops once every window size has a marker that ends inside the chunk. A single window
+// size takes the findFirstMarker fast path instead. Chunks are handed out in stream order, so once every
+// window size has a marker in an earlier chunk, the later chunks are skipped while all earlier chunks are
+// still searched.
+template <size_t... WindowSizes>
+    requires (sizeof...(WindowSizes) >= 1 && ((WindowSizes >= 1) && ...))
+std::array<int64_t, sizeof...(WindowSizes)> findFirstMarkersParallel(std::string_view data, size_t threadCount, size_t chunkSize = 1 << 20) noexcept
+{
+    assert(chunkSize >= 1);
+
+    constexpr std::array<size_t, sizeof...(WindowSizes)> windowSizes{ WindowSizes... };
+    constexpr size_t windowCount = windowSizes.size();
+    constexpr size_t overlap = std::ranges::max(windowSizes) - 1;
+    const size_t chunkCount = (data.size() + chunkSize - 1) / chunkSize;
+
+    // [chunk * windowCount + window]
+    std::vector<int64_t> chunkMarkers(chunkCount * windowCount, -1);
+    std::array<std::atomic<size_t>, windowCount> firstMatchingChunks;
+    for(auto& firstMatchingChunk : firstMatchingChunks) {
+        firstMatchingChunk.store(chunkCount);
+    }
+    std::atomic<size_t> nextChunk{ 0 };
+
+    const auto chunkNeeded = [&](size_t chunk) {
+        for(const auto& firstMatchingChunk : firstMatchingChunks) {
+            if(chunk < firstMatchingChunk.load(std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const auto searchChunks = [&]() {
+        for(size_t chunk = nextChunk++; chunk < chunkCount && chunkNeeded(chunk); chunk = nextChunk++) {
+            const size_t chunkBegin = chunk * chunkSize;
+            const size_t searchBegin = chunkBegin >= overlap ? chunkBegin - overlap : 0;
+            const size_t searchEnd = std::min(chunkBegin + chunkSize, data.size());
+            const auto searchData = data.substr(searchBegin, searchEnd - searchBegin);
+            int64_t* markers = &chunkMarkers[chunk * windowCount];
+
+            if constexpr (windowCount == 1) {
+                // the search starts exactly window size - 1 early, so the first marker ends inside the chunk
+                const auto marker = findFirstMarker<WindowSizes...>(searchData);
+                markers[0] = marker < 0 ? -1 : marker + static_cast<int64_t>(searchBegin);
+            }
+            else {
+                // window sizes with a marker in an earlier chunk count as found already
+                size_t foundCount = 0;
+                std::array<bool, windowCount> found{};
+                for(size_t w = 0; w < windowCount; ++w) {
+                    found[w] = firstMatchingChunks[w].load(std::memory_order_relaxed) < chunk;
+                    foundCount += found[w];
+                }
+
+                scanMarkers(searchData, windowSizes, [&](size_t w, uint64_t position) {
+                    // markers that end in the overlap belong to the previous chunk
+                    if(position > chunkBegin && not found[w]) {
+                        found[w] = true;
+                        markers[w] = static_cast<int64_t>(position);
+                        ++foundCount;
+                    }
+                    return foundCount < windowCount;
+                }, searchBegin);
+            }
+
+            for(size_t w = 0; w < windowCount; ++w) {
+                if(markers[w] < 0) {
+                    continue;
+                }
+                size_t expected = firstMatchingChunks[w].load();
+                while(chunk < expected && not firstMatchingChunks[w].compare_exchange_weak(expected, chunk)) {
                 }
             }
         }
+    };
 
-        if(beginningFound) {
-            return i + 1;
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(threadCount);
+        for(size_t i = 1; i < threadCount; ++i) {
+            threads.emplace_back(searchChunks);
         }
+        searchChunks();
     }
 
-    return -1;
+    std::array<int64_t, windowCount> result;
+    for(size_t w = 0; w < windowCount; ++w) {
+        const size_t matchingChunk = firstMatchingChunks[w].load();
+        result[w] = matchingChunk < chunkCount ? chunkMarkers[matchingChunk * windowCount + w] : -1;
+    }
+    return result;
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    const MappedFile file("communication_input");
+    if(not file.valid) {
+        std::cerr << "Cannot open communication_input.\n";
+        return 1;
+    }
+
+    std::string_view data = file.view();
+    if(data.ends_with('\n')) {
+        data.remove_suffix(1);
+    }
+
+    // packet and message markers
+    constexpr size_t PacketWindowSize = 4;
+    constexpr size_t MessageWindowSize = 14;
+    constexpr std::array<size_t, 2> windowSizes{ PacketWindowSize, MessageWindowSize };
 
-    std::string data;
-    data.reserve(1024);
+    // counting every marker position needs the whole stream, so it is a single pass over all window sizes
+    if(argc > 1 && std::string_view(argv[1]) == "--count") {
+        std::array<uint64_t, 2> markerCounts{};
+        scanMarkers(data, windowSizes, [&markerCounts](size_t w, uint64_t) {
+            ++markerCounts[w];
+            return true;
+        });
+
+        std::cout << std::format("The stream contains {} packet and {} message marker positions.\n", markerCounts[0], markerCounts[1]);
+        return 0;
+    }
 
-    std::fstream file("communication_input");
-    std::getline(file, data);
+    const auto firstMarkers = findFirstMarkersParallel<PacketWindowSize, MessageWindowSize>(data, std::thread::hardware_concurrency());
 
-    std::cout << std::format("The start of the packet marker is: {}\n", findFirstConsecutiveUniqueByteChain(data, 4));
-    std::cout << std::format("Part 2:\nThe start of the message marker is: {}\n", findFirstConsecutiveUniqueByteChain(data, 14));
+    std::cout << std::format("The start of the packet marker is: {}\n", firstMarkers[0]);
+    std::cout << std::format("Part 2:\nThe start of the message marker is: {}\n", firstMarkers[1]);
 
     return 0;
 }
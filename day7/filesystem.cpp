@@ -1,184 +1,390 @@
 #include <algorithm>
-#include <array>
 #include <cassert>
+#include <charconv>
 #include <cstdint>
+#include <cstring>
 #include <format>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <numeric>
-#include <regex>
+#include <optional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
-using namespace std::string_literals;
+// Stores every distinct name once. Names are copied into fixed size blocks that never move,
+// so the returned views stay valid for the lifetime of the arena.
+struct NameArena {
+    constexpr static size_t BlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockUsed = BlockSize;
+    std::unordered_set<std::string_view> names;
+
+    std::string_view intern(std::string_view name) noexcept;
+};
+
+std::string_view NameArena::intern(std::string_view name) noexcept
+{
+    if(const auto it = names.find(name); it != names.end()) {
+        return *it;
+    }
+
+    if(blockUsed + name.size() > BlockSize) {
+        blocks.emplace_back(std::make_unique<char[]>(std::max(BlockSize, name.size())));
+        blockUsed = 0;
+    }
+    char* storage = blocks.back().get() + blockUsed;
+    std::memcpy(storage, name.data(), name.size());
+    blockUsed += name.size();
+
+    return *names.emplace(storage, name.size()).first;
+}
+
+using DirectoryIndex = uint32_t;
 
 struct File {
-    std::string name;
+    DirectoryIndex directory;
+    std::string_view name;
     size_t size;
 };
 
 struct Directory {
-    std::string name;
-    std::vector<Directory> subDirectories;
+    // the root directory is its own parent
+    DirectoryIndex parent;
+    std::string_view name;
+    // size of the files directly in this directory
+    size_t directSize{ 0 };
+};
+
+struct ChildKey {
+    DirectoryIndex parent;
+    std::string_view name;
+
+    bool operator==(const ChildKey& other) const noexcept = default;
+};
+
+struct ChildKeyHash {
+    size_t operator()(const ChildKey& key) const noexcept
+    {
+        return std::hash<std::string_view>{}(key.name) ^ (static_cast<size_t>(key.parent) * 0x9E3779B97F4A7C15ULL);
+    }
+};
+
+// Flat directory table, a directory is always created after its parent so every
+// directory index is larger than the index of its parent.
+struct Filesystem {
+    constexpr static DirectoryIndex RootDirectory = 0;
+    constexpr static size_t TotalSpace = 70000000;
+    constexpr static size_t SpaceRequiredByUpdate = 30000000;
+
+    NameArena nameArena;
+    std::vector<Directory> directories;
     std::vector<File> files;
-    size_t size{ 0 };
+    // (parent, name) -> child directory
+    std::unordered_map<ChildKey, DirectoryIndex, ChildKeyHash> children;
+
+    Filesystem() noexcept { directories.emplace_back(RootDirectory, nameArena.intern("/")); }
+
+    [[nodiscard]] static size_t freeSpace(size_t usedSpace) noexcept { return TotalSpace - usedSpace; }
+
+    DirectoryIndex addDirectory(DirectoryIndex parent, std::string_view name) noexcept;
+    void addFile(DirectoryIndex directory, std::string_view name, size_t size) noexcept;
+    [[nodiscard]] DirectoryIndex findChild(DirectoryIndex parent, std::string_view name) const noexcept;
+
+    // the size of every directory including all subdirectories, indexed like directories
+    [[nodiscard]] std::vector<size_t> totalSizes() const noexcept;
+};
+
+DirectoryIndex Filesystem::addDirectory(DirectoryIndex parent, std::string_view name) noexcept
+{
+    const auto interned = nameArena.intern(name);
+    const auto [it, inserted] = children.try_emplace(ChildKey{ parent, interned }, static_cast<DirectoryIndex>(directories.size()));
+    if(inserted) {
+        directories.emplace_back(parent, interned);
+    }
+    return it->second;
+}
+
+void Filesystem::addFile(DirectoryIndex directory, std::string_view name, size_t size) noexcept
+{
+    files.emplace_back(directory, nameArena.intern(name), size);
+    directories[directory].directSize += size;
+}
+
+DirectoryIndex Filesystem::findChild(DirectoryIndex parent, std::string_view name) const noexcept
+{
+    const auto it = children.find(ChildKey{ parent, name });
+    assert(it != children.end());
+    return it->second;
+}
+
+// Children always come after their parents, so walking the table backwards is a post-order:
+// every directory is added to its parent after all of its own children were added to it.
+std::vector<size_t> Filesystem::totalSizes() const noexcept
+{
+    std::vector<size_t> sizes(directories.size());
+    for(size_t i = 0; i < directories.size(); ++i) {
+        sizes[i] = directories[i].directSize;
+    }
+    for(size_t i = directories.size() - 1; i > RootDirectory; --i) {
+        sizes[directories[i].parent] += sizes[i];
+    }
+    return sizes;
+}
+
+// All directory sizes sorted with prefix sums, every threshold query is a binary search.
+struct DirectorySizeIndex {
+    size_t usedSpace = 0;
+    std::vector<size_t> sortedSizes;
+    // prefixSums[i] is the sum of the i smallest sizes
+    std::vector<size_t> prefixSums;
+
+    explicit DirectorySizeIndex(const Filesystem& filesystem) noexcept;
 
-    explicit Directory(std::string&& name) noexcept : name(name) { subDirectories.reserve(8); }
-    size_t calculateSize() noexcept;
     [[nodiscard]] size_t sumSizesUpTo(size_t limit) const noexcept;
+    // max size_t when no directory is big enough
     [[nodiscard]] size_t findSmallestDirectoryAboveSize(size_t minimumRequiredSize) const noexcept;
+
+    [[nodiscard]] std::vector<size_t> sumSizesUpTo(std::span<const size_t> limits) const noexcept;
+    [[nodiscard]] std::vector<size_t> findSmallestDirectoriesAboveSizes(std::span<const size_t> minimumRequiredSizes) const noexcept;
 };
 
-size_t Directory::calculateSize() noexcept
+DirectorySizeIndex::DirectorySizeIndex(const Filesystem& filesystem) noexcept
+    : sortedSizes(filesystem.totalSizes())
 {
-    const size_t directSize = std::accumulate(files.begin(), files.end(), 0ULL, [](size_t s, const File& f) { return s + f.size; });
-    const size_t indirectSize = std::accumulate(subDirectories.begin(), subDirectories.end(), 0ULL, [](size_t s, Directory& d) { return s + d.calculateSize(); });
-    size = directSize + indirectSize;
-    return size;
+    usedSpace = sortedSizes[Filesystem::RootDirectory];
+    std::ranges::sort(sortedSizes);
+
+    prefixSums.resize(sortedSizes.size() + 1, 0);
+    std::partial_sum(sortedSizes.begin(), sortedSizes.end(), prefixSums.begin() + 1);
 }
 
-size_t Directory::sumSizesUpTo(size_t limit) const noexcept
+size_t DirectorySizeIndex::sumSizesUpTo(size_t limit) const noexcept
 {
-    size_t sizeSum = size <= limit ? size : 0;
-    const size_t indirectSum = std::accumulate(subDirectories.begin(), subDirectories.end(), 0ULL, [&limit](size_t s, const Directory& d) { return s + d.sumSizesUpTo(limit); });
-    return sizeSum + indirectSum;
+    const auto count = std::distance(sortedSizes.begin(), std::ranges::upper_bound(sortedSizes, limit));
+    return prefixSums[count];
 }
 
-size_t Directory::findSmallestDirectoryAboveSize(size_t minimumRequiredSize) const noexcept
+size_t DirectorySizeIndex::findSmallestDirectoryAboveSize(size_t minimumRequiredSize) const noexcept
 {
-    if(size < minimumRequiredSize) {
-        return std::numeric_limits<size_t>::max();
+    const auto it = std::ranges::lower_bound(sortedSizes, minimumRequiredSize);
+    return it == sortedSizes.end() ? std::numeric_limits<size_t>::max() : *it;
+}
+
+std::vector<size_t> DirectorySizeIndex::sumSizesUpTo(std::span<const size_t> limits) const noexcept
+{
+    std::vector<size_t> result;
+    result.reserve(limits.size());
+    for(const auto limit : limits) {
+        result.emplace_back(sumSizesUpTo(limit));
     }
-    size_t minimumSize = size;
-    for(const auto& dir : subDirectories) {
-        const auto subDirMinimum = dir.findSmallestDirectoryAboveSize(minimumRequiredSize);
-        if(subDirMinimum >= minimumRequiredSize & subDirMinimum < minimumSize) {
-            minimumSize = subDirMinimum;
-        }
+    return result;
+}
+
+std::vector<size_t> DirectorySizeIndex::findSmallestDirectoriesAboveSizes(std::span<const size_t> minimumRequiredSizes) const noexcept
+{
+    std::vector<size_t> result;
+    result.reserve(minimumRequiredSizes.size());
+    for(const auto minimumRequiredSize : minimumRequiredSizes) {
+        result.emplace_back(findSmallestDirectoryAboveSize(minimumRequiredSize));
     }
-    return minimumSize;
+    return result;
 }
 
-struct Filesystem {
-    Directory rootDirectory;
-    constexpr static size_t TotalSpace = 70000000;
-    constexpr static size_t SpaceRequiredByUpdate = 30000000;
+constexpr std::string_view CdPrefix = "$ cd ";
+constexpr std::string_view DirPrefix = "dir ";
 
-    Filesystem() noexcept : rootDirectory("/"s) {}
-    size_t freeSpace() const noexcept { return TotalSpace - rootDirectory.size; }
+struct FileEntry {
+    size_t size;
+    std::string_view name;
 };
 
+// "<size> <name>" lines of a listing
+std::optional<FileEntry> parseFileEntry(std::string_view line) noexcept
+{
+    size_t size = 0;
+    const auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), size);
+    if(ec != std::errc{} || ptr == line.data() + line.size() || *ptr != ' ') {
+        return std::nullopt;
+    }
+    return FileEntry{ size, line.substr(ptr - line.data() + 1) };
+}
+
 struct Shell {
     Filesystem filesystem;
-    std::vector<uint64_t> currentDirIndex;
-    Directory* currentDirectory = &filesystem.rootDirectory;
+    DirectoryIndex currentDirectory = Filesystem::RootDirectory;
 
     void parseFilesystem(std::string_view filepath) noexcept;
-    void updateCurrentDirPointer() noexcept;
 
     void commandCd(std::string_view parameters) noexcept;
-    void discoverDirectory(std::string&& name) noexcept;
-    void discoverFile(std::string&& name, size_t size) noexcept;
+    void discoverDirectory(std::string_view name) noexcept;
+    void discoverFile(std::string_view name, size_t size) noexcept;
 };
 
 void Shell::parseFilesystem(std::string_view filepath) noexcept
 {
     std::fstream file(filepath.data());
     std::string line;
-    // ignore first line
-    std::getline(file, line);
-
-    std::regex dirRegex("^dir ([A-Za-z.]+)$");
-    std::regex fileRegex("^([1-9][0-9]*) ([A-Za-z.]+)$");
-    std::regex lsRegex("^\\$ ls$");
-    std::regex cdRegex("^\\$ cd (..|[A-Za-z]+)$");
-    std::smatch subMatches;
-
-    bool skipRead = false;
-    while(skipRead || std::getline(file, line)) {
-        skipRead = false;
-
-        // check for cd command
-        if(std::regex_match(line, subMatches, cdRegex)) {
-            assert(subMatches[1].matched);
-            commandCd(subMatches[1].str());
-        }
-        else if(std::regex_match(line, lsRegex)) {
-            skipRead = true;
 
-            while(std::getline(file, line)) {
-                // check for file
-                if(std::regex_match(line, subMatches, fileRegex)) {
-                    discoverFile(subMatches[2].str(), std::stoull(subMatches[1].str()));
-                }
-                // check for dir
-                else if(std::regex_match(line, subMatches, dirRegex)) {
-                    discoverDirectory(subMatches[1].str());
-                }
-                else {
-                    // cd command or end of file
-                    break;
-                }
+    while(std::getline(file, line)) {
+        const std::string_view view = line;
+
+        if(view.starts_with(CdPrefix)) {
+            commandCd(view.substr(CdPrefix.size()));
+        }
+        else if(view == "$ ls") {
+            // the listing follows as plain lines
+        }
+        else if(view.starts_with(DirPrefix)) {
+            discoverDirectory(view.substr(DirPrefix.size()));
+        }
+        else {
+            const auto fileEntry = parseFileEntry(view);
+            assert(fileEntry.has_value() && "Unexpected input format.");
+            if(fileEntry.has_value()) {
+                discoverFile(fileEntry->name, fileEntry->size);
             }
         }
     }
 }
 
-void Shell::updateCurrentDirPointer() noexcept
-{
-    Directory* dir = &filesystem.rootDirectory;
-    for(const auto& i : currentDirIndex) {
-        dir = &dir->subDirectories[i];
-    }
-    currentDirectory = dir;
-}
-
 void Shell::commandCd(std::string_view parameters) noexcept
 {
-    if(parameters == "..") {
-        currentDirIndex.pop_back();
+    if(parameters == "/") {
+        currentDirectory = Filesystem::RootDirectory;
+    }
+    else if(parameters == "..") {
+        currentDirectory = filesystem.directories[currentDirectory].parent;
     }
     else {
-        auto foundIt = std::ranges::find(currentDirectory->subDirectories, parameters, &Directory::name);
-        assert(foundIt != currentDirectory->subDirectories.end());
-        currentDirIndex.emplace_back(std::distance(currentDirectory->subDirectories.begin(), foundIt));
+        currentDirectory = filesystem.findChild(currentDirectory, parameters);
     }
-    updateCurrentDirPointer();
 }
 
-void Shell::discoverDirectory(std::string&& name) noexcept
+void Shell::discoverDirectory(std::string_view name) noexcept
 {
-    currentDirectory->subDirectories.emplace_back(std::move(name));
+    filesystem.addDirectory(currentDirectory, name);
 }
 
-void Shell::discoverFile(std::string&& name, size_t size) noexcept
+void Shell::discoverFile(std::string_view name, size_t size) noexcept
 {
-    currentDirectory->files.emplace_back(std::move(name), size);
+    filesystem.addFile(currentDirectory, name, size);
 }
 
-int main()
+// Computes the directory totals straight from the transcript without building a tree, only the
+// running sizes of the directories on the current path are kept. onDirectory(size) is called for
+// every directory when it is left, the root directory comes last and its size is returned.
+// Every directory has to be listed once, like in the transcripts of the puzzle.
+template <typename DirectoryCallback>
+size_t streamDirectorySizes(std::string_view filepath, DirectoryCallback&& onDirectory) noexcept
 {
-    Shell shell;
-    shell.parseFilesystem("filesystem_input");
-//    shell.parseFilesystem("filesystem_input_test");
+    // the root directory stays at the bottom
+    std::vector<size_t> pathSizes{ 0 };
+    pathSizes.reserve(64);
+
+    const auto leaveDirectory = [&]() {
+        const size_t size = pathSizes.back();
+        pathSizes.pop_back();
+        pathSizes.back() += size;
+        onDirectory(size);
+    };
 
-    const auto totalSize = shell.filesystem.rootDirectory.calculateSize();
-    std::cout << std::format("The total size is {} ElfBytes.\n", totalSize);
+    std::fstream file(filepath.data());
+    std::string line;
+    while(std::getline(file, line)) {
+        const std::string_view view = line;
 
-    const auto sizeUpTo100000 = shell.filesystem.rootDirectory.sumSizesUpTo(100000);
+        if(view.starts_with(CdPrefix)) {
+            const auto parameters = view.substr(CdPrefix.size());
+            if(parameters == "/") {
+                while(pathSizes.size() > 1) {
+                    leaveDirectory();
+                }
+            }
+            else if(parameters == "..") {
+                assert(pathSizes.size() > 1);
+                if(pathSizes.size() > 1) {
+                    leaveDirectory();
+                }
+            }
+            else {
+                pathSizes.emplace_back(0);
+            }
+        }
+        else if(view == "$ ls" || view.starts_with(DirPrefix)) {
+            // directories are counted when they are entered
+        }
+        else {
+            const auto fileEntry = parseFileEntry(view);
+            assert(fileEntry.has_value() && "Unexpected input format.");
+            if(fileEntry.has_value()) {
+                pathSizes.back() += fileEntry->size;
+            }
+        }
+    }
+
+    while(pathSizes.size() > 1) {
+        leaveDirectory();
+    }
+    onDirectory(pathSizes.back());
+
+    return pathSizes.back();
+}
+
+void printReport(size_t usedSpace, size_t sizeUpTo100000, size_t minimumDeleteDirectorySize) noexcept
+{
+    std::cout << std::format("The total size is {} ElfBytes.\n", usedSpace);
     std::cout << std::format("The total size of all directories with a size up to 100000 is {} ElfBytes.\n", sizeUpTo100000);
 
-    const auto sizeToDelete = Filesystem::SpaceRequiredByUpdate - shell.filesystem.freeSpace();
+    const auto freeSpace = Filesystem::freeSpace(usedSpace);
+    const auto sizeToDelete = Filesystem::SpaceRequiredByUpdate - freeSpace;
     std::cout << std::format("Used space            : {:12} ElfBytes\n"
                              "Free space            : {:12} ElfBytes\n"
                              "Missing required space: {:12} ElfBytes\n",
-                             shell.filesystem.rootDirectory.size, shell.filesystem.freeSpace(), sizeToDelete);
-    const auto minimumDeleteDirectorySize = shell.filesystem.rootDirectory.findSmallestDirectoryAboveSize(sizeToDelete);
+                             usedSpace, freeSpace, sizeToDelete);
     std::cout << std::format("The directory that is big enough to clear enough space but is the\n"
                              "smallest one of all the available has a size of {} ElfBytes.\n", minimumDeleteDirectorySize);
+}
+
+// pass --du to compute the answers from the transcript without building the directory tree
+int main(int argc, char** argv)
+{
+    constexpr std::string_view inputPath = "filesystem_input";
+//    constexpr std::string_view inputPath = "filesystem_input_test";
+
+    if(argc > 1 && std::string_view(argv[1]) == "--du") {
+        size_t sizeUpTo100000 = 0;
+        const size_t usedSpace = streamDirectorySizes(inputPath, [&sizeUpTo100000](size_t size) {
+            sizeUpTo100000 += size <= 100000 ? size : 0;
+        });
+
+        // the required size depends on the total, so the smallest directory needs a second pass
+        const auto sizeToDelete = Filesystem::SpaceRequiredByUpdate - Filesystem::freeSpace(usedSpace);
+        size_t minimumDeleteDirectorySize = std::numeric_limits<size_t>::max();
+        streamDirectorySizes(inputPath, [&](size_t size) {
+            if(size >= sizeToDelete & size < minimumDeleteDirectorySize) {
+                minimumDeleteDirectorySize = size;
+            }
+        });
+
+        printReport(usedSpace, sizeUpTo100000, minimumDeleteDirectorySize);
+        return 0;
+    }
+
+    Shell shell;
+    shell.parseFilesystem(inputPath);
+
+    const DirectorySizeIndex sizeIndex(shell.filesystem);
+    const auto sizeToDelete = Filesystem::SpaceRequiredByUpdate - Filesystem::freeSpace(sizeIndex.usedSpace);
+    printReport(sizeIndex.usedSpace, sizeIndex.sumSizesUpTo(100000), sizeIndex.findSmallestDirectoryAboveSize(sizeToDelete));
 
     return 0;
 }
@@ -5,208 +5,789 @@
 #include <format>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <mutex>
 #include <numeric>
+#include <ranges>
 #include <regex>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct ScenicScores {
+    size_t rows = 0;
+    size_t cols = 0;
+    // row major like the heights
+    std::vector<uint64_t> scores;
+
+    struct Tree {
+        uint64_t score;
+        size_t row;
+        size_t col;
+    };
+
+    [[nodiscard]] uint64_t score(size_t row, size_t col) const noexcept { return scores[row * cols + col]; }
+    [[nodiscard]] uint64_t maximum() const noexcept;
+    // the k trees with the highest scores, the highest first
+    [[nodiscard]] std::vector<Tree> topK(size_t k) const noexcept;
+};
+
+// Keeps the k trees with the highest scores in a min-heap, the front is the weakest kept tree.
+struct TopTrees {
+    size_t k;
+    std::vector<ScenicScores::Tree> heap;
+
+    explicit TopTrees(size_t count) noexcept : k(count) { heap.reserve(k); }
+
+    void offer(const ScenicScores::Tree& tree) noexcept;
+    // the kept trees, the highest score first
+    [[nodiscard]] std::vector<ScenicScores::Tree> sorted() const noexcept;
+};
+
 struct TreeGrid {
 
-    std::vector<std::vector<uint16_t>> grid;
+    // row major heights, one byte per tree
+    std::vector<uint8_t> heights;
     size_t rows;
     size_t cols;
 
-    void parseFromFile(std::string_view filepath) noexcept;
+    [[nodiscard]] uint8_t height(size_t row, size_t col) const noexcept { return heights[row * cols + col]; }
 
-    bool isTreeFromOutsideVisible(size_t row, size_t col) const noexcept;
+    // false when the file cannot be read or is not a grid of digit rows with equal widths
+    [[nodiscard]] bool parseFromFile(std::string_view filepath) noexcept;
+
+    [[nodiscard]] std::vector<uint8_t> calcVisibilityMap() const noexcept;
     size_t countFromOutsideVisibleTrees() const noexcept;
-    size_t calcScenicScoreOfTree(int64_t row, int64_t col) const noexcept;
-    size_t findMaximumScenicScore() const noexcept;
+    [[nodiscard]] ScenicScores calcScenicScores(size_t threadCount) const noexcept;
+};
+
+// Evaluates a grid in place in the mapped input file, where every row is cols digits and a line break.
+struct BandedForest {
+    // columns per tile of the vertical sweeps, the last seen tables of a tile stay in L2
+    constexpr static size_t TileCols = 2048;
+
+    const char* data = nullptr;
+    size_t rows = 0;
+    size_t cols = 0;
+    // rows per band, below 65535 so the rows inside a band fit the 16 bit offsets of the band summaries
+    size_t bandRows = 1024;
+
+    struct Result {
+        size_t visibleCount = 0;
+        // the trees with the highest scenic scores, the highest first
+        std::vector<ScenicScores::Tree> topTrees;
+    };
+
+    // false when the data is not a grid of digit rows with equal widths, each ended by a line break
+    [[nodiscard]] bool attach(std::string_view grid) noexcept;
+
+    [[nodiscard]] uint8_t height(size_t row, size_t col) const noexcept { return static_cast<uint8_t>(data[row * (cols + 1) + col] - '0'); }
+    [[nodiscard]] size_t bandCount() const noexcept { return (rows + bandRows - 1) / bandRows; }
+
+    [[nodiscard]] Result evaluate(size_t topCount, size_t threadCount) const noexcept;
+};
+
+// Keeps the visibility and the scenic scores of a grid up to date while single trees change their height.
+struct ForestModel {
+    // the sides a tree is visible from, one bit each
+    enum Side : uint8_t {
+        Left = 1,
+        Right = 2,
+        Top = 4,
+        Bottom = 8,
+    };
+
+    TreeGrid grid;
+    std::vector<uint8_t> visibleSides;
+    // left times right respectively top times bottom viewing distance of every tree
+    std::vector<uint64_t> rowRanges;
+    std::vector<uint64_t> columnRanges;
+    ScenicScores scenicScores;
+    size_t visibleCount = 0;
+    // max segment tree over scenicScores, every node holds the index of the best tree below it,
+    // the leaves start at leafCount and unused leaves hold the tree count
+    size_t leafCount = 1;
+    std::vector<size_t> bestBelow;
+
+    explicit ForestModel(TreeGrid treeGrid) noexcept;
+
+    // false when the position is outside of the grid or the height is no digit
+    [[nodiscard]] bool setHeight(size_t row, size_t col, uint8_t h) noexcept;
+
+    [[nodiscard]] uint64_t maximumScore() const noexcept;
+    // the k trees with the highest scores, the highest first, like ScenicScores::topK
+    [[nodiscard]] std::vector<ScenicScores::Tree> topTrees(size_t k) const noexcept;
+
+private:
+    void sweepRow(size_t row) noexcept;
+    void sweepColumn(size_t col) noexcept;
+    // sets the sides of the tree at index i and keeps visibleCount, its score and bestBelow in sync
+    void updateTree(size_t i, uint8_t sides, uint8_t sideMask) noexcept;
+    [[nodiscard]] size_t betterTree(size_t lhs, size_t rhs) const noexcept;
 };
 
-bool TreeGrid::isTreeFromOutsideVisible(size_t row, size_t col) const noexcept
+constexpr size_t HeightCount = 10;
+
+// Runs work(begin, end) over [0, count) split into one range per thread.
+template <typename Work>
+void parallelFor(size_t count, size_t threadCount, Work&& work) noexcept
+{
+    threadCount = std::clamp<size_t>(threadCount, 1, std::max<size_t>(count, 1));
+    std::vector<std::jthread> threads;
+    threads.reserve(threadCount);
+    for(size_t i = 0; i < threadCount; ++i) {
+        const size_t begin = count * i / threadCount;
+        const size_t end = count * (i + 1) / threadCount;
+        threads.emplace_back([&work, begin, end]() { work(begin, end); });
+    }
+}
+
+// A tree is visible from a side when it is higher than the running maximum of that side. The left and
+// right sweeps run along the rows, the top and bottom sweeps keep one running maximum per column and
+// also walk row by row, so every sweep reads the grid sequentially.
+std::vector<uint8_t> TreeGrid::calcVisibilityMap() const noexcept
 {
-    const auto treeHeight = grid[row][col];
+    std::vector<uint8_t> visible(heights.size(), 0);
 
-    // check top
-    {
-        bool topVisible = true;
-        for (size_t r = 0; r < row; ++r) {
-            if (grid[r][col] >= treeHeight) {
-                topVisible = false;
-                break;
-            }
+    for(size_t r = 0; r < rows; ++r) {
+        const uint8_t* row = &heights[r * cols];
+        uint8_t* visibleRow = &visible[r * cols];
+
+        int leftMaximum = -1;
+        for(size_t c = 0; c < cols; ++c) {
+            visibleRow[c] |= row[c] > leftMaximum;
+            leftMaximum = std::max<int>(leftMaximum, row[c]);
         }
-        if (topVisible) {
-            return true;
+
+        int rightMaximum = -1;
+        for(size_t c = cols; c-- > 0;) {
+            visibleRow[c] |= row[c] > rightMaximum;
+            rightMaximum = std::max<int>(rightMaximum, row[c]);
         }
     }
-    // check bottom
-    {
-        bool bottomVisible = true;
-        for (size_t r = row + 1; r < rows; ++r) {
-            if (grid[r][col] >= treeHeight) {
-                bottomVisible = false;
-                break;
-            }
+
+    std::vector<int> columnMaximum(cols, -1);
+    for(size_t r = 0; r < rows; ++r) {
+        for(size_t c = 0; c < cols; ++c) {
+            const auto h = heights[r * cols + c];
+            visible[r * cols + c] |= h > columnMaximum[c];
+            columnMaximum[c] = std::max<int>(columnMaximum[c], h);
         }
-        if (bottomVisible) {
-            return true;
+    }
+
+    std::ranges::fill(columnMaximum, -1);
+    for(size_t r = rows; r-- > 0;) {
+        for(size_t c = 0; c < cols; ++c) {
+            const auto h = heights[r * cols + c];
+            visible[r * cols + c] |= h > columnMaximum[c];
+            columnMaximum[c] = std::max<int>(columnMaximum[c], h);
         }
     }
-    // check left
-    {
-        bool leftVisible = true;
-        for (size_t c = 0; c < col; ++c) {
-            if (grid[row][c] >= treeHeight) {
-                leftVisible = false;
-                break;
+
+    return visible;
+}
+
+size_t TreeGrid::countFromOutsideVisibleTrees() const noexcept
+{
+    const auto visible = calcVisibilityMap();
+    return static_cast<size_t>(std::ranges::count(visible, uint8_t{ 1 }));
+}
+
+// The viewing distance in one direction is the distance to the closest tree that is at least as high.
+// Heights are only 0 to 9, so a table of the last seen position of every height answers that in O(1),
+// the grid edge counts as last seen at every height. Rows are swept first, then the columns are swept
+// row by row with one table per column, rows and columns are split over the threads.
+ScenicScores TreeGrid::calcScenicScores(size_t threadCount) const noexcept
+{
+    ScenicScores result{ rows, cols, std::vector<uint64_t>(heights.size(), 0) };
+
+    parallelFor(rows, threadCount, [&](size_t rowBegin, size_t rowEnd) {
+        for(size_t r = rowBegin; r < rowEnd; ++r) {
+            const uint8_t* row = &heights[r * cols];
+            uint64_t* scoreRow = &result.scores[r * cols];
+
+            std::array<size_t, HeightCount> lastSeen{};
+            for(size_t c = 0; c < cols; ++c) {
+                const size_t blocker = *std::max_element(lastSeen.begin() + row[c], lastSeen.end());
+                scoreRow[c] = c - blocker;
+                lastSeen[row[c]] = c;
+            }
+
+            lastSeen.fill(cols - 1);
+            for(size_t c = cols; c-- > 0;) {
+                const size_t blocker = *std::min_element(lastSeen.begin() + row[c], lastSeen.end());
+                scoreRow[c] *= blocker - c;
+                lastSeen[row[c]] = c;
             }
         }
-        if (leftVisible) {
-            return true;
+    });
+
+    parallelFor(cols, threadCount, [&](size_t colBegin, size_t colEnd) {
+        std::vector<std::array<size_t, HeightCount>> lastSeen(colEnd - colBegin);
+        std::vector<size_t> topDistances(colEnd - colBegin);
+
+        for(auto& columnSeen : lastSeen) {
+            columnSeen.fill(0);
         }
-    }
-    // check right
-    {
-        bool rightVisible = true;
-        for (size_t c = col + 1; c < cols; ++c) {
-            if (grid[row][c] >= treeHeight) {
-                rightVisible = false;
-                break;
+        for(size_t r = 0; r < rows; ++r) {
+            for(size_t c = colBegin; c < colEnd; ++c) {
+                auto& columnSeen = lastSeen[c - colBegin];
+                const auto h = heights[r * cols + c];
+                const size_t blocker = *std::max_element(columnSeen.begin() + h, columnSeen.end());
+                result.scores[r * cols + c] *= r - blocker;
+                columnSeen[h] = r;
             }
         }
-        if (rightVisible) {
-            return true;
+
+        for(auto& columnSeen : lastSeen) {
+            columnSeen.fill(rows - 1);
+        }
+        for(size_t r = rows; r-- > 0;) {
+            for(size_t c = colBegin; c < colEnd; ++c) {
+                auto& columnSeen = lastSeen[c - colBegin];
+                const auto h = heights[r * cols + c];
+                const size_t blocker = *std::min_element(columnSeen.begin() + h, columnSeen.end());
+                result.scores[r * cols + c] *= blocker - r;
+                columnSeen[h] = r;
+            }
         }
+    });
+
+    return result;
+}
+
+uint64_t ScenicScores::maximum() const noexcept
+{
+    return scores.empty() ? 0 : *std::ranges::max_element(scores);
+}
+
+std::vector<ScenicScores::Tree> ScenicScores::topK(size_t k) const noexcept
+{
+    TopTrees best(k);
+    for(size_t i = 0; i < scores.size(); ++i) {
+        best.offer(Tree{ scores[i], i / cols, i % cols });
     }
-    return false;
+    return best.sorted();
 }
 
-size_t TreeGrid::countFromOutsideVisibleTrees() const noexcept
+// a higher score wins, on equal scores the tree that comes first in the grid wins
+[[nodiscard]] bool scoresHigher(const ScenicScores::Tree& lhs, const ScenicScores::Tree& rhs) noexcept
 {
-    size_t count = 0;
-    count += 2 * grid.size();
-    count += 2 * (grid[0].size() - 2);
+    return lhs.score != rhs.score ? lhs.score > rhs.score : std::pair(lhs.row, lhs.col) < std::pair(rhs.row, rhs.col);
+}
 
-    for(size_t c = 1; c < cols - 1; ++c) {
-        for(size_t r = 1; r < rows - 1; ++r) {
-            if(isTreeFromOutsideVisible(r, c)) {
-                ++count;
-            }
-        }
+void TopTrees::offer(const ScenicScores::Tree& tree) noexcept
+{
+    if(heap.size() < k) {
+        heap.emplace_back(tree);
+        std::ranges::push_heap(heap, &scoresHigher);
     }
+    else if(k > 0 && scoresHigher(tree, heap.front())) {
+        std::ranges::pop_heap(heap, &scoresHigher);
+        heap.back() = tree;
+        std::ranges::push_heap(heap, &scoresHigher);
+    }
+}
 
-    return count;
+std::vector<ScenicScores::Tree> TopTrees::sorted() const noexcept
+{
+    auto result = heap;
+    std::ranges::sort(result, &scoresHigher);
+    return result;
 }
 
-size_t TreeGrid::calcScenicScoreOfTree(int64_t row, int64_t col) const noexcept
+bool TreeGrid::parseFromFile(std::string_view filepath) noexcept
 {
-    const auto treeHeight = grid[row][col];
+    std::fstream file(filepath.data());
+    if(!file) {
+        std::cerr << std::format("Cannot open {}.\n", filepath);
+        return false;
+    }
+    std::string line;
 
-    size_t topRange;
-    size_t bottomRange;
-    size_t leftRange;
-    size_t rightRange;
+    heights.clear();
+    heights.reserve(128 * 128);
+    rows = 0;
+    cols = 0;
 
-    // calc top viewing distance
-    {
-        int64_t r = row - 1;
-        for (; r >= 0; --r) {
-            if (grid[r][col] >= treeHeight) {
-                break;
-            }
-            if(r == 0) {
-                break;
-            }
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if(!line.empty() && line.back() == '\r') {
+            line.pop_back();
         }
-        topRange = row - r;
-    }
-    // calc bottom viewing distance
-    {
-        int64_t r = row + 1;
-        for (; r < rows; ++r) {
-            if (grid[r][col] >= treeHeight) {
-                break;
-            }
-            if(r == rows - 1) {
-                break;
-            }
+        if(line.empty()) {
+            continue;
         }
-        bottomRange = r - row;
-    }
-    // calc left viewing distance
-    {
-        int64_t c = col - 1;
-        for (; c >= 0; --c) {
-            if (grid[row][c] >= treeHeight) {
-                break;
-            }
-            if(c == 0) {
-                break;
-            }
+
+        // the heights index the per height tables of the sweeps, so nothing else may get through
+        const bool digitsOnly = std::ranges::all_of(line, [](char c) { return c >= '0' && c <= '9'; });
+        if(!digitsOnly || (cols != 0 && line.size() != cols)) {
+            std::cerr << std::format("Unexpected input format in line {}: \"{}\"\n", lineNumber, line);
+            return false;
+        }
+        cols = line.size();
+        ++rows;
+
+        for(const auto& c : line) {
+            heights.emplace_back(static_cast<uint8_t>(c - '0'));
         }
-        leftRange = col - c;
     }
-    // calc right viewing distance
-    {
-        int64_t c = col + 1;
-        for (; c < cols; ++c) {
-            if (grid[row][c] >= treeHeight) {
-                break;
-            }
-            if(c == cols - 1) {
-                break;
-            }
+
+    return true;
+}
+
+ForestModel::ForestModel(TreeGrid treeGrid) noexcept
+    : grid(std::move(treeGrid))
+    , visibleSides(grid.heights.size(), 0)
+    , rowRanges(grid.heights.size(), 0)
+    , columnRanges(grid.heights.size(), 0)
+    , scenicScores{ grid.rows, grid.cols, std::vector<uint64_t>(grid.heights.size(), 0) }
+{
+    while(leafCount < grid.heights.size()) {
+        leafCount *= 2;
+    }
+    bestBelow.assign(2 * leafCount, grid.heights.size());
+
+    for(size_t r = 0; r < grid.rows; ++r) {
+        sweepRow(r);
+    }
+    for(size_t c = 0; c < grid.cols; ++c) {
+        sweepColumn(c);
+    }
+}
+
+// A new height only changes what is seen along its row and its column, so only these two are swept again.
+// Everything else in the grid keeps its sides and distances, an update is O((rows + cols) log(rows * cols))
+// with the segment tree refresh of every swept tree.
+bool ForestModel::setHeight(size_t row, size_t col, uint8_t h) noexcept
+{
+    if(row >= grid.rows || col >= grid.cols || h >= HeightCount) {
+        return false;
+    }
+
+    auto& treeHeight = grid.heights[row * grid.cols + col];
+    if(treeHeight != h) {
+        treeHeight = h;
+        sweepRow(row);
+        sweepColumn(col);
+    }
+    return true;
+}
+
+// the tree count stands for no tree, equal scores go to the tree that comes first in the grid
+size_t ForestModel::betterTree(size_t lhs, size_t rhs) const noexcept
+{
+    const auto& scores = scenicScores.scores;
+    if(lhs == scores.size() || rhs == scores.size()) {
+        return std::min(lhs, rhs);
+    }
+    return scores[rhs] > scores[lhs] || (scores[rhs] == scores[lhs] && rhs < lhs) ? rhs : lhs;
+}
+
+uint64_t ForestModel::maximumScore() const noexcept
+{
+    return bestBelow[1] == scenicScores.scores.size() ? 0 : scenicScores.scores[bestBelow[1]];
+}
+
+// Best first walk down the segment tree, a node is only expanded once its best tree is among the best.
+std::vector<ScenicScores::Tree> ForestModel::topTrees(size_t k) const noexcept
+{
+    const auto worseNode = [&](size_t lhs, size_t rhs) { return betterTree(bestBelow[lhs], bestBelow[rhs]) == bestBelow[rhs] && bestBelow[lhs] != bestBelow[rhs]; };
+    std::vector<size_t> candidates{ 1 };
+    std::vector<ScenicScores::Tree> result;
+    result.reserve(k);
+
+    while(result.size() < k && !candidates.empty()) {
+        std::ranges::pop_heap(candidates, worseNode);
+        const size_t node = candidates.back();
+        candidates.pop_back();
+
+        const size_t i = bestBelow[node];
+        if(i == scenicScores.scores.size()) {
+            continue;
+        }
+        if(node >= leafCount) {
+            result.emplace_back(scenicScores.scores[i], i / grid.cols, i % grid.cols);
+            continue;
         }
-        rightRange = c - col;
+        for(const size_t child : { 2 * node, 2 * node + 1 }) {
+            candidates.emplace_back(child);
+            std::ranges::push_heap(candidates, worseNode);
+        }
+    }
+
+    return result;
+}
+
+void ForestModel::updateTree(size_t i, uint8_t sides, uint8_t sideMask) noexcept
+{
+    const bool wasVisible = visibleSides[i] != 0;
+    visibleSides[i] = (visibleSides[i] & ~sideMask) | sides;
+    const bool isVisible = visibleSides[i] != 0;
+    visibleCount = visibleCount + isVisible - wasVisible;
+
+    scenicScores.scores[i] = rowRanges[i] * columnRanges[i];
+
+    size_t node = leafCount + i;
+    bestBelow[node] = i;
+    for(node /= 2; node > 0; node /= 2) {
+        bestBelow[node] = betterTree(bestBelow[2 * node], bestBelow[2 * node + 1]);
+    }
+}
+
+void ForestModel::sweepRow(size_t row) noexcept
+{
+    const size_t cols = grid.cols;
+    const uint8_t* heights = &grid.heights[row * cols];
+    uint64_t* ranges = &rowRanges[row * cols];
+    std::vector<uint8_t> sides(cols, 0);
+
+    int maximum = -1;
+    std::array<size_t, HeightCount> lastSeen{};
+    for(size_t c = 0; c < cols; ++c) {
+        sides[c] |= heights[c] > maximum ? Left : 0;
+        maximum = std::max<int>(maximum, heights[c]);
+        ranges[c] = c - *std::max_element(lastSeen.begin() + heights[c], lastSeen.end());
+        lastSeen[heights[c]] = c;
+    }
+
+    maximum = -1;
+    lastSeen.fill(cols - 1);
+    for(size_t c = cols; c-- > 0;) {
+        sides[c] |= heights[c] > maximum ? Right : 0;
+        maximum = std::max<int>(maximum, heights[c]);
+        ranges[c] *= *std::min_element(lastSeen.begin() + heights[c], lastSeen.end()) - c;
+        lastSeen[heights[c]] = c;
+    }
+
+    for(size_t c = 0; c < cols; ++c) {
+        updateTree(row * cols + c, sides[c], Left | Right);
+    }
+}
+
+void ForestModel::sweepColumn(size_t col) noexcept
+{
+    const size_t rows = grid.rows;
+    const size_t cols = grid.cols;
+    std::vector<uint8_t> sides(rows, 0);
+
+    int maximum = -1;
+    std::array<size_t, HeightCount> lastSeen{};
+    for(size_t r = 0; r < rows; ++r) {
+        const auto h = grid.height(r, col);
+        sides[r] |= h > maximum ? Top : 0;
+        maximum = std::max<int>(maximum, h);
+        columnRanges[r * cols + col] = r - *std::max_element(lastSeen.begin() + h, lastSeen.end());
+        lastSeen[h] = r;
+    }
+
+    maximum = -1;
+    lastSeen.fill(rows - 1);
+    for(size_t r = rows; r-- > 0;) {
+        const auto h = grid.height(r, col);
+        sides[r] |= h > maximum ? Bottom : 0;
+        maximum = std::max<int>(maximum, h);
+        columnRanges[r * cols + col] *= *std::min_element(lastSeen.begin() + h, lastSeen.end()) - r;
+        lastSeen[h] = r;
+    }
+
+    for(size_t r = 0; r < rows; ++r) {
+        updateTree(r * cols + col, sides[r], Top | Bottom);
     }
-    return topRange * bottomRange * leftRange * rightRange;
 }
 
-size_t TreeGrid::findMaximumScenicScore() const noexcept
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    bool valid = false;
+
+    explicit MappedFile(std::string_view filepath) noexcept;
+    ~MappedFile() noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::string_view view() const noexcept { return { data, size }; }
+};
+
+MappedFile::MappedFile(std::string_view filepath) noexcept
 {
-    size_t maximumScore = std::numeric_limits<size_t>::min();
+    const int fd = open(filepath.data(), O_RDONLY);
+    if(fd < 0) {
+        return;
+    }
 
-    for(size_t c = 1; c < cols - 1; ++c) {
-        for(size_t r = 1; r < rows - 1; ++r) {
-            const size_t score = calcScenicScoreOfTree(r, c);
-            maximumScore = std::max(maximumScore, score);
+    struct stat fileStat{};
+    if(fstat(fd, &fileStat) == 0) {
+        size = static_cast<size_t>(fileStat.st_size);
+        if(size == 0) {
+            valid = true;
+        }
+        else if(void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0); mapped != MAP_FAILED) {
+            data = static_cast<const char*>(mapped);
+            valid = true;
         }
     }
+    close(fd);
+}
 
-    return maximumScore;
+MappedFile::~MappedFile() noexcept
+{
+    if(data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
 }
 
-void TreeGrid::parseFromFile(std::string_view filepath) noexcept
+bool BandedForest::attach(std::string_view grid) noexcept
 {
-    std::fstream file(filepath.data());
-    std::string line;
+    data = grid.data();
+    cols = std::min(grid.find('\n'), grid.size());
+    // the line break after the last row is optional
+    rows = grid.empty() ? 0 : (grid.size() + 1) / (cols + 1);
+    if(rows * (cols + 1) != grid.size() && rows * (cols + 1) != grid.size() + 1) {
+        return false;
+    }
+    // every byte is checked, the sweeps index their tables with the heights
+    for(size_t r = 0; r < rows; ++r) {
+        const auto row = grid.substr(r * (cols + 1), cols + 1);
+        const auto digits = row.substr(0, cols);
+        if(!std::ranges::all_of(digits, [](char c) { return c >= '0' && c <= '9'; })) {
+            return false;
+        }
+        if(row.size() > cols && row[cols] != '\n') {
+            return false;
+        }
+    }
+    return true;
+}
 
-    grid.reserve(128);
+// The bands are evaluated one after another and all threads work on the band at hand, the rows are split
+// for the row sweeps and the columns for the vertical sweeps. What the vertical sweeps need from outside
+// of the band is carried as per column state. Above the band that is the running maximum and the last
+// row of every height. Below the band it is the next band that holds each height, together with a first
+// pass that stores the first row of every height per band and column as a 16 bit offset into the band.
+//
+// Memory beyond the mapped file is 20 bytes per band and column for those offsets, which is about 2% of
+// the input with 1024 rows per band, 81 bytes per column of carried state and 9 bytes per tree of the band
+// in work. Only the offsets grow with the rows of the grid.
+BandedForest::Result BandedForest::evaluate(size_t topCount, size_t threadCount) const noexcept
+{
+    constexpr uint16_t NoOffset = std::numeric_limits<uint16_t>::max();
+    constexpr uint32_t NoBand = std::numeric_limits<uint32_t>::max();
+    assert(rows < std::numeric_limits<uint32_t>::max());
+    assert(bandRows > 0 && bandRows < NoOffset);
 
-    while (std::getline(file, line)) {
-        grid.emplace_back();
-        grid.back().reserve(line.size());
+    if(rows == 0 || cols == 0) {
+        return {};
+    }
 
-        for(const auto& c : line) {
-            grid.back().emplace_back(c - '0');
+    const size_t bands = bandCount();
+    const auto bandEnd = [&](size_t band) { return std::min(rows, (band + 1) * bandRows); };
+
+    // [(band * cols + col) * HeightCount + height], the first row of the height in the column of the band
+    std::vector<uint16_t> firstOffsets(bands * cols * HeightCount, NoOffset);
+    parallelFor(bands, threadCount, [&](size_t bandBegin, size_t bandLast) {
+        for(size_t b = bandBegin; b < bandLast; ++b) {
+            uint16_t* offsets = &firstOffsets[b * cols * HeightCount];
+            for(size_t r = bandEnd(b); r-- > b * bandRows;) {
+                for(size_t c = 0; c < cols; ++c) {
+                    const auto h = height(r, c);
+                    assert(h < HeightCount);
+                    offsets[c * HeightCount + h] = static_cast<uint16_t>(r - b * bandRows);
+                }
+            }
         }
+    });
+
+    // per column the maximum height + 1 above the band, 0 when there is no tree, and [col * HeightCount + height]
+    // the last row above the band with that height, the grid edge counts as seen at every height
+    std::vector<uint8_t> maximumAbove(cols, 0);
+    std::vector<uint32_t> seenAbove(cols * HeightCount, 0);
+    // [col * HeightCount + height], the next band below the band in work with that height in the column
+    std::vector<uint32_t> nextBand(cols * HeightCount, NoBand);
+
+    // every entry only moves forward, so all advances together are O(bands * cols * HeightCount)
+    const auto advanceNextBand = [&](size_t i, size_t afterBand) {
+        size_t b = afterBand + 1;
+        while(b < bands && firstOffsets[b * cols * HeightCount + i] == NoOffset) {
+            ++b;
+        }
+        nextBand[i] = b < bands ? static_cast<uint32_t>(b) : NoBand;
+    };
+    parallelFor(nextBand.size(), threadCount, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; ++i) {
+            advanceNextBand(i, 0);
+        }
+    });
+
+    Result result;
+    TopTrees top(topCount);
+    std::mutex resultMutex;
+    std::vector<uint64_t> scores;
+    std::vector<uint8_t> visible;
+
+    for(size_t b = 0; b < bands; ++b) {
+        const size_t rowBegin = b * bandRows;
+        const size_t rowEnd = bandEnd(b);
+        scores.assign((rowEnd - rowBegin) * cols, 0);
+        visible.assign((rowEnd - rowBegin) * cols, 0);
+
+        parallelFor(rowEnd - rowBegin, threadCount, [&](size_t begin, size_t end) {
+            for(size_t r = rowBegin + begin; r < rowBegin + end; ++r) {
+                const char* row = data + r * (cols + 1);
+                uint64_t* scoreRow = &scores[(r - rowBegin) * cols];
+                uint8_t* visibleRow = &visible[(r - rowBegin) * cols];
+
+                int leftMaximum = -1;
+                std::array<size_t, HeightCount> lastSeen{};
+                for(size_t c = 0; c < cols; ++c) {
+                    const auto h = static_cast<uint8_t>(row[c] - '0');
+                    visibleRow[c] |= h > leftMaximum;
+                    leftMaximum = std::max<int>(leftMaximum, h);
+                    scoreRow[c] = c - *std::max_element(lastSeen.begin() + h, lastSeen.end());
+                    lastSeen[h] = c;
+                }
+
+                int rightMaximum = -1;
+                lastSeen.fill(cols - 1);
+                for(size_t c = cols; c-- > 0;) {
+                    const auto h = static_cast<uint8_t>(row[c] - '0');
+                    visibleRow[c] |= h > rightMaximum;
+                    rightMaximum = std::max<int>(rightMaximum, h);
+                    scoreRow[c] *= *std::min_element(lastSeen.begin() + h, lastSeen.end()) - c;
+                    lastSeen[h] = c;
+                }
+            }
+        });
+
+        parallelFor(cols, threadCount, [&](size_t colBegin, size_t colEnd) {
+            size_t visibleCount = 0;
+            TopTrees bandTop(topCount);
+            std::vector<uint8_t> maximumBelow;
+            std::vector<uint32_t> seenBelow;
+
+            for(size_t tileBegin = colBegin; tileBegin < colEnd; tileBegin += TileCols) {
+                const size_t tileEnd = std::min(colEnd, tileBegin + TileCols);
+
+                // the state above is updated in place, after the band it is the state above the next band
+                for(size_t r = rowBegin; r < rowEnd; ++r) {
+                    for(size_t c = tileBegin; c < tileEnd; ++c) {
+                        const auto h = height(r, c);
+                        const size_t i = (r - rowBegin) * cols + c;
+                        auto* columnSeen = &seenAbove[c * HeightCount];
+                        visible[i] |= h + 1 > maximumAbove[c];
+                        maximumAbove[c] = std::max<uint8_t>(maximumAbove[c], h + 1);
+                        scores[i] *= r - *std::max_element(columnSeen + h, columnSeen + HeightCount);
+                        columnSeen[h] = static_cast<uint32_t>(r);
+                    }
+                }
+
+                maximumBelow.assign(tileEnd - tileBegin, 0);
+                seenBelow.assign((tileEnd - tileBegin) * HeightCount, static_cast<uint32_t>(rows - 1));
+                for(size_t c = tileBegin; c < tileEnd; ++c) {
+                    for(size_t h = 0; h < HeightCount; ++h) {
+                        const uint32_t band = nextBand[c * HeightCount + h];
+                        if(band != NoBand) {
+                            seenBelow[(c - tileBegin) * HeightCount + h] = static_cast<uint32_t>(band * bandRows + firstOffsets[(band * cols + c) * HeightCount + h]);
+                            maximumBelow[c - tileBegin] = static_cast<uint8_t>(h + 1);
+                        }
+                    }
+                }
+                for(size_t r = rowEnd; r-- > rowBegin;) {
+                    for(size_t c = tileBegin; c < tileEnd; ++c) {
+                        const auto h = height(r, c);
+                        const size_t i = (r - rowBegin) * cols + c;
+                        auto& columnMaximum = maximumBelow[c - tileBegin];
+                        auto* columnSeen = &seenBelow[(c - tileBegin) * HeightCount];
+                        visible[i] |= h + 1 > columnMaximum;
+                        columnMaximum = std::max<uint8_t>(columnMaximum, h + 1);
+                        scores[i] *= *std::min_element(columnSeen + h, columnSeen + HeightCount) - r;
+                        columnSeen[h] = static_cast<uint32_t>(r);
+                    }
+                }
+
+                for(size_t r = rowBegin; r < rowEnd; ++r) {
+                    for(size_t c = tileBegin; c < tileEnd; ++c) {
+                        const size_t i = (r - rowBegin) * cols + c;
+                        visibleCount += visible[i];
+                        bandTop.offer(ScenicScores::Tree{ scores[i], r, c });
+                    }
+                }
+
+                for(size_t i = tileBegin * HeightCount; i < tileEnd * HeightCount; ++i) {
+                    if(nextBand[i] == b + 1) {
+                        advanceNextBand(i, b + 1);
+                    }
+                }
+            }
+
+            const std::scoped_lock lock(resultMutex);
+            result.visibleCount += visibleCount;
+            for(const auto& tree : bandTop.heap) {
+                top.offer(tree);
+            }
+        });
     }
 
-    rows = grid.size();
-    cols = grid[0].size();
+    result.topTrees = top.sorted();
+    return result;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    TreeGrid treeGrid;
-    treeGrid.parseFromFile("treehouse_input");
+    constexpr std::string_view inputPath = "treehouse_input";
+    constexpr size_t TopCount = 3;
+
+    // the most scenic trees are cut down one after another, the model only refreshes their rows and columns
+    if(argc > 1 && std::string_view(argv[1]) == "--cut") {
+        TreeGrid treeGrid;
+        if(!treeGrid.parseFromFile(inputPath)) {
+            return 1;
+        }
+
+        ForestModel model(std::move(treeGrid));
+        const auto topTrees = model.topTrees(TopCount);
+        std::cout << std::format("Cutting down the {} most scenic trees:\n", topTrees.size());
+        for(const auto& tree : topTrees) {
+            [[maybe_unused]] const bool updated = model.setHeight(tree.row, tree.col, 0);
+            assert(updated);
+            std::cout << std::format("    row {:4}, column {:4} cut, {} trees visible, maximum scenic score {}\n",
+                                     tree.row, tree.col, model.visibleCount, model.maximumScore());
+        }
+        return 0;
+    }
 
-    std::cout << std::format("From the outside visible trees: {}\n", treeGrid.countFromOutsideVisibleTrees());
-    std::cout << std::format("The maximum possible scenic score is: {}\n", treeGrid.findMaximumScenicScore());
+    size_t visibleCount = 0;
+    std::vector<ScenicScores::Tree> topTrees;
+
+    const MappedFile mappedFile(inputPath);
+    BandedForest forest;
+    if(mappedFile.valid && forest.attach(mappedFile.view())) {
+        auto result = forest.evaluate(TopCount, std::thread::hardware_concurrency());
+        visibleCount = result.visibleCount;
+        topTrees = std::move(result.topTrees);
+    }
+    else {
+        TreeGrid treeGrid;
+        if(!treeGrid.parseFromFile(inputPath)) {
+            return 1;
+        }
+        visibleCount = treeGrid.countFromOutsideVisibleTrees();
+        topTrees = treeGrid.calcScenicScores(std::thread::hardware_concurrency()).topK(TopCount);
+    }
+
+    std::cout << std::format("From the outside visible trees: {}\n", visibleCount);
+    std::cout << std::format("The maximum possible scenic score is: {}\n", topTrees.empty() ? 0 : topTrees.front().score);
+    for(const auto& tree : topTrees) {
+        std::cout << std::format("    scenic score {:8} at row {:4}, column {:4}\n", tree.score, tree.row, tree.col);
+    }
 
     return 0;
 }
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <format>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <numeric>
 #include <regex>
@@ -18,6 +19,99 @@ struct Pos {
     auto operator<=>(const Pos& other) const noexcept = default;
 };
 
+// Set of visited cells as 64 x 64 bitmap tiles, only tiles with a visited cell exist. The tiles are found
+// through an open addressing hash of their coordinates, so memory grows with the visited area.
+struct VisitedCells {
+    constexpr static int64_t TileShift = 6;
+    constexpr static int64_t TileMask = (int64_t{ 1 } << TileShift) - 1;
+
+    using Tile = std::array<uint64_t, TileMask + 1>;
+
+    struct Slot {
+        Pos tile;
+        // index into tiles + 1, 0 marks an empty slot
+        size_t index = 0;
+    };
+
+    std::vector<Tile> tiles;
+    std::vector<Slot> slots{ 64 };
+    size_t visitedCount = 0;
+
+    // consecutive cells are mostly in the same tile
+    Pos lastTile;
+    size_t lastIndex = 0;
+
+    // true when the cell was not visited before
+    bool insert(const Pos& cell) noexcept;
+    [[nodiscard]] size_t count() const noexcept { return visitedCount; }
+
+private:
+    [[nodiscard]] size_t findOrAddTile(const Pos& tile) noexcept;
+    void grow() noexcept;
+};
+
+[[nodiscard]] size_t tileHash(const Pos& tile) noexcept
+{
+    const uint64_t hash = static_cast<uint64_t>(tile.x) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(tile.y) * 0xC2B2AE3D27D4EB4Full;
+    return static_cast<size_t>(hash ^ hash >> 32);
+}
+
+bool VisitedCells::insert(const Pos& cell) noexcept
+{
+    // arithmetic shifts, so negative coordinates round down to their tile
+    const Pos tile{ cell.x >> TileShift, cell.y >> TileShift };
+    if(lastIndex == 0 || tile != lastTile) {
+        lastIndex = findOrAddTile(tile) + 1;
+        lastTile = tile;
+    }
+
+    auto& row = tiles[lastIndex - 1][static_cast<size_t>(cell.y & TileMask)];
+    const uint64_t bit = uint64_t{ 1 } << (cell.x & TileMask);
+    const bool added = (row & bit) == 0;
+    row |= bit;
+    visitedCount += added;
+    return added;
+}
+
+size_t VisitedCells::findOrAddTile(const Pos& tile) noexcept
+{
+    // at most half of the slots are used, so probing always ends at an empty slot
+    if(2 * (tiles.size() + 1) > slots.size()) {
+        grow();
+    }
+
+    const size_t mask = slots.size() - 1;
+    for(size_t i = tileHash(tile) & mask;; i = (i + 1) & mask) {
+        auto& slot = slots[i];
+        if(slot.index == 0) {
+            tiles.emplace_back();
+            slot = Slot{ tile, tiles.size() };
+            return tiles.size() - 1;
+        }
+        if(slot.tile == tile) {
+            return slot.index - 1;
+        }
+    }
+}
+
+void VisitedCells::grow() noexcept
+{
+    std::vector<Slot> oldSlots(slots.size() * 2);
+    std::swap(slots, oldSlots);
+
+    const size_t mask = slots.size() - 1;
+    for(const auto& slot : oldSlots) {
+        if(slot.index == 0) {
+            continue;
+        }
+        size_t i = tileHash(slot.tile) & mask;
+        while(slots[i].index != 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+}
+
 struct Head {
     Pos pos;
 };
@@ -30,13 +124,15 @@ struct Rope {
     Head head;
     Tail tail;
 
-    std::vector<Pos> tailPosHistory;
+    VisitedCells visitedTailPositions;
+
+    Rope() noexcept { visitedTailPositions.insert(tail.pos); }
 
     [[nodiscard]] bool sameRow() const noexcept { return head.pos.y == tail.pos.y; }
     [[nodiscard]] bool sameCol() const noexcept { return head.pos.x == tail.pos.x; }
     [[nodiscard]] int64_t absRowDiff() const noexcept { return std::abs(head.pos.y - tail.pos.y); }
     [[nodiscard]] int64_t absColDiff() const noexcept { return std::abs(head.pos.x - tail.pos.x); }
-    [[nodiscard]] int64_t getUniqueTailPosCount() noexcept;
+    [[nodiscard]] int64_t getUniqueTailPosCount() const noexcept { return static_cast<int64_t>(visitedTailPositions.count()); }
 
     void moveHeadUp(int64_t count) noexcept;
     void moveHeadDown(int64_t count) noexcept;
@@ -49,14 +145,6 @@ struct Rope {
     void moveTailTowardHeadInCol() noexcept;
 };
 
-int64_t Rope::getUniqueTailPosCount() noexcept
-{
-    std::ranges::sort(tailPosHistory);
-    auto removeRange = std::ranges::unique(tailPosHistory);
-    tailPosHistory.erase(removeRange.begin(), removeRange.end());
-    return std::ssize(tailPosHistory);
-}
-
 void Rope::moveHeadUp(int64_t count) noexcept
 {
     for(int64_t i = 0; i < count; ++i) {
@@ -91,6 +179,7 @@ void Rope::moveHeadRight(int64_t count) noexcept
 
 void Rope::updateTailPos() noexcept
 {
+    const auto previousTailPos = tail.pos;
     const auto absRowDifference = absRowDiff();
     const auto absColDifference = absColDiff();
 
@@ -119,7 +208,10 @@ void Rope::updateTailPos() noexcept
         }
     }
 
-    tailPosHistory.emplace_back(tail.pos);
+    // the start position is recorded on construction, only actual moves add cells
+    if(tail.pos != previousTailPos) {
+        visitedTailPositions.insert(tail.pos);
+    }
 }
 
 void Rope::moveTailTowardHeadInRow() noexcept